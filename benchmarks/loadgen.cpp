@@ -0,0 +1,313 @@
+// HTTP load generator for the users API.
+//
+// Each connection is a thread with its own keep-alive httplib::Client that
+// issues a weighted random mix of requests for a fixed duration, then the
+// tool prints throughput per operation and a latency histogram.
+//
+// Usage: loadgen [--host=127.0.0.1] [--port=8080] [--connections=8]
+//                [--duration=10] [--users=10000]
+//                [--mix=get:80,list:5,create:5,update:10,delete:0]
+//
+//   get     GET /api/users/:id for a random preloaded user
+//   list    GET /api/users?limit=100&after=<random id>
+//   create  POST /api/users
+//   update  PUT /api/users/:id for a random preloaded user
+//   delete  DELETE /api/users/:id of a user this connection created
+//
+// --users preloads that many users through POST /api/users/_bulk first.
+// Build with -DBUILD_BENCHMARKS=ON and run ./bin/loadgen while the server runs.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../external/httplib.h"
+#include "../external/nlohmann/json.hpp"
+#include "utils/Metrics.hpp"
+
+namespace {
+
+enum Op { OP_GET, OP_LIST, OP_CREATE, OP_UPDATE, OP_DELETE, OP_COUNT };
+const char* const OP_NAMES[OP_COUNT] = {"get", "list", "create", "update", "delete"};
+
+struct Config {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 8;
+    int duration = 10;
+    int users = 10000;
+    int weights[OP_COUNT] = {80, 5, 5, 10, 0};
+};
+
+// Value-initialize (make_unique) so the histogram atomics start at zero
+struct Totals {
+    Metrics::Histogram latency[OP_COUNT];
+    std::atomic<uint64_t> byStatusClass[6] = {};  // [0] = transport failures
+};
+
+bool parseMix(const std::string& mix, int (&weights)[OP_COUNT]) {
+    std::fill(std::begin(weights), std::end(weights), 0);
+    size_t start = 0;
+    while (start < mix.size()) {
+        size_t end = mix.find(',', start);
+        if (end == std::string::npos) {
+            end = mix.size();
+        }
+        std::string item = mix.substr(start, end - start);
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+
+        int op = 0;
+        while (op < OP_COUNT && item.compare(0, colon, OP_NAMES[op]) != 0) {
+            ++op;
+        }
+        if (op == OP_COUNT) {
+            return false;
+        }
+        weights[op] = std::stoi(item.substr(colon + 1));
+        start = end + 1;
+    }
+    return true;
+}
+
+bool parseArgs(int argc, char* argv[], Config& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            return false;
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+
+        if (key == "host") config.host = value;
+        else if (key == "port") config.port = std::stoi(value);
+        else if (key == "connections") config.connections = std::stoi(value);
+        else if (key == "duration") config.duration = std::stoi(value);
+        else if (key == "users") config.users = std::stoi(value);
+        else if (key == "mix") {
+            if (!parseMix(value, config.weights)) return false;
+        }
+        else return false;
+    }
+    int totalWeight = 0;
+    for (int weight : config.weights) {
+        if (weight < 0) return false;
+        totalWeight += weight;
+    }
+    return config.connections > 0 && config.duration > 0 && totalWeight > 0;
+}
+
+// Emails must be unique, so each run tags its own and every user body gets a
+// distinct local part: "load-<run>-<n>" for preloaded users, "<run>-<seed>-<n>"
+// for creates and "<run>-u<id>" for updates
+const std::string runTag = std::to_string(std::random_device{}());
+
+std::string userBody(int n, const std::string& emailLocal) {
+    return "{\"name\":\"Load " + std::to_string(n) + "\",\"email\":\"" + emailLocal +
+           "@example.com\",\"age\":" + std::to_string(18 + n % 60) + "}";
+}
+
+// Create users in bulk batches; returns their ids
+std::vector<int> preload(const Config& config) {
+    httplib::Client client(config.host, config.port);
+    std::vector<int> ids;
+    const int batchSize = 10000;
+
+    for (int first = 0; first < config.users; first += batchSize) {
+        int count = std::min(batchSize, config.users - first);
+        std::string body;
+        for (int i = 0; i < count; ++i) {
+            body += "{\"op\":\"create\",";
+            body += userBody(first + i, "load-" + runTag + "-" + std::to_string(first + i)).substr(1);
+            body += '\n';
+        }
+
+        auto res = client.Post("/api/users/_bulk", body, "application/x-ndjson");
+        if (!res || res->status != 200) {
+            throw std::runtime_error("preload failed: " + (res ? std::to_string(res->status) : httplib::to_string(res.error())));
+        }
+        auto response = nlohmann::json::parse(res->body);
+        for (const auto& result : response["data"]) {
+            if (result["status"].get<int>() == 201) {
+                ids.push_back(result["id"].get<int>());
+            }
+        }
+    }
+    return ids;
+}
+
+void runConnection(const Config& config, const std::vector<int>& ids, unsigned seed,
+                   std::chrono::steady_clock::time_point deadline, Totals& totals) {
+    httplib::Client client(config.host, config.port);
+    client.set_keep_alive(true);
+    client.set_tcp_nodelay(true);  // Headers and body go out as separate writes
+
+    std::mt19937 rng(seed);
+    std::discrete_distribution<int> pickOp(std::begin(config.weights), std::end(config.weights));
+    std::uniform_int_distribution<size_t> pickId(0, ids.empty() ? 0 : ids.size() - 1);
+    std::vector<int> created;
+    int counter = 0;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        int op = pickOp(rng);
+        if ((op == OP_GET || op == OP_UPDATE || op == OP_LIST) && ids.empty()) {
+            op = OP_CREATE;
+        }
+        if (op == OP_DELETE && created.empty()) {
+            op = OP_CREATE;
+        }
+
+        uint64_t start = Metrics::now();
+        httplib::Result res;
+        switch (op) {
+            case OP_GET:
+                res = client.Get("/api/users/" + std::to_string(ids[pickId(rng)]));
+                break;
+            case OP_LIST:
+                res = client.Get("/api/users?limit=100&after=" + std::to_string(ids[pickId(rng)]));
+                break;
+            case OP_CREATE:
+                ++counter;
+                res = client.Post("/api/users",
+                                  userBody(counter, runTag + "-" + std::to_string(seed) + "-" + std::to_string(counter)),
+                                  "application/json");
+                break;
+            case OP_UPDATE: {
+                int id = ids[pickId(rng)];
+                res = client.Put("/api/users/" + std::to_string(id), userBody(id, runTag + "-u" + std::to_string(id)),
+                                 "application/json");
+                break;
+            }
+            case OP_DELETE:
+                res = client.Delete("/api/users/" + std::to_string(created.back()));
+                created.pop_back();
+                break;
+        }
+        totals.latency[op].record(Metrics::now() - start);
+
+        if (!res) {
+            totals.byStatusClass[0].fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        int statusClass = res->status / 100;
+        totals.byStatusClass[statusClass >= 1 && statusClass <= 5 ? statusClass : 0].fetch_add(1, std::memory_order_relaxed);
+
+        if (op == OP_CREATE && res->status == 201) {
+            created.push_back(nlohmann::json::parse(res->body)["data"]["id"].get<int>());
+        }
+    }
+}
+
+std::string formatLatency(uint64_t nanoseconds) {
+    char buffer[32];
+    if (nanoseconds < 1000000) {
+        std::snprintf(buffer, sizeof(buffer), "%.1f us", nanoseconds / 1e3);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.2f ms", nanoseconds / 1e6);
+    }
+    return buffer;
+}
+
+void printHistogram(const Metrics::Histogram::Snapshot& data) {
+    // Collapse the fine buckets into powers of two for display
+    std::map<uint64_t, uint64_t> rows;
+    for (size_t i = 0; i < data.counts.size(); ++i) {
+        if (data.counts[i] == 0) {
+            continue;
+        }
+        uint64_t upper = 1;
+        while (upper < Metrics::Histogram::lowerBound(i + 1)) {
+            upper <<= 1;
+        }
+        rows[upper] += data.counts[i];
+    }
+
+    uint64_t peak = 0;
+    for (const auto& row : rows) {
+        peak = std::max(peak, row.second);
+    }
+    for (const auto& row : rows) {
+        size_t width = static_cast<size_t>(50.0 * row.second / peak + 0.5);
+        std::printf("  <= %10s |%-50s %llu\n", formatLatency(row.first).c_str(),
+                    std::string(width, '#').c_str(), static_cast<unsigned long long>(row.second));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if (!parseArgs(argc, argv, config)) {
+        std::cerr << "usage: loadgen [--host=H] [--port=P] [--connections=N] [--duration=S] [--users=N]"
+                     " [--mix=get:80,list:5,create:5,update:10,delete:0]" << std::endl;
+        return 2;
+    }
+
+    try {
+        std::vector<int> ids = preload(config);
+        std::cout << "preloaded " << ids.size() << " users" << std::endl;
+
+        auto totals = std::make_unique<Totals>();
+        auto started = std::chrono::steady_clock::now();
+        auto deadline = started + std::chrono::seconds(config.duration);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < config.connections; ++i) {
+            threads.emplace_back(runConnection, std::cref(config), std::cref(ids), 1000u + i, deadline, std::ref(*totals));
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        Metrics::Histogram::Snapshot all;
+        all.counts.assign(Metrics::Histogram::BUCKETS, 0);
+        std::printf("%-8s %10s %10s %10s %10s %10s %10s\n", "op", "requests", "req/s", "p50", "p99", "p99.9", "mean");
+        for (int op = 0; op < OP_COUNT; ++op) {
+            auto data = totals->latency[op].snapshot();
+            for (size_t i = 0; i < data.counts.size(); ++i) {
+                all.counts[i] += data.counts[i];
+            }
+            all.count += data.count;
+            all.sum += data.sum;
+            if (data.count == 0) {
+                continue;
+            }
+            std::printf("%-8s %10llu %10.0f %10s %10s %10s %10s\n", OP_NAMES[op],
+                        static_cast<unsigned long long>(data.count), data.count / seconds,
+                        formatLatency(data.quantile(0.5)).c_str(), formatLatency(data.quantile(0.99)).c_str(),
+                        formatLatency(data.quantile(0.999)).c_str(), formatLatency(data.sum / data.count).c_str());
+        }
+        if (all.count == 0) {
+            std::cout << "no requests completed" << std::endl;
+            return 1;
+        }
+        std::printf("%-8s %10llu %10.0f %10s %10s %10s %10s\n", "total",
+                    static_cast<unsigned long long>(all.count), all.count / seconds,
+                    formatLatency(all.quantile(0.5)).c_str(), formatLatency(all.quantile(0.99)).c_str(),
+                    formatLatency(all.quantile(0.999)).c_str(), formatLatency(all.sum / all.count).c_str());
+
+        std::printf("status: 2xx=%llu 3xx=%llu 4xx=%llu 5xx=%llu failed=%llu\n",
+                    static_cast<unsigned long long>(totals->byStatusClass[2].load()),
+                    static_cast<unsigned long long>(totals->byStatusClass[3].load()),
+                    static_cast<unsigned long long>(totals->byStatusClass[4].load()),
+                    static_cast<unsigned long long>(totals->byStatusClass[5].load()),
+                    static_cast<unsigned long long>(totals->byStatusClass[0].load() + totals->byStatusClass[1].load()));
+
+        std::cout << "latency histogram:" << std::endl;
+        printHistogram(all);
+    } catch (const std::exception& e) {
+        std::cerr << "loadgen: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
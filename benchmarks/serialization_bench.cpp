@@ -0,0 +1,96 @@
+// Micro-benchmark: nlohmann::json DOM serialization vs. the direct JsonWriter
+// path for User and the ApiResponse envelope, and DOM parsing vs. the SAX
+// UserParser for request bodies.
+//
+// Build with -DBUILD_BENCHMARKS=ON and run ./bin/serialization_bench
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "models/User.hpp"
+#include "models/UserParser.hpp"
+#include "utils/Response.hpp"
+
+namespace {
+
+template <typename Fn>
+void run(const char* name, size_t iterations, Fn&& fn) {
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sink += fn();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed / iterations << " ns/op"
+              << " (checksum " << sink << ")" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    const User user(42, "Jane \"JD\" Doe", "jane.doe@example.com", 34);
+
+    std::vector<User> users;
+    for (int i = 1; i <= 1000; ++i) {
+        users.emplace_back(i, "User " + std::to_string(i), "user" + std::to_string(i) + "@example.com", 20 + i % 50);
+    }
+
+    std::cout << "Single user (1M iterations)" << std::endl;
+    run("  dom    User::toJson().dump()", 1000000, [&]() {
+        return user.toJson().dump().size();
+    });
+    run("  direct User::writeJson()", 1000000, [&]() {
+        static std::string out;
+        out.clear();
+        user.writeJson(out);
+        return out.size();
+    });
+
+    std::cout << "Envelope with one user (1M iterations)" << std::endl;
+    run("  dom    ApiResponse::toJson().dump()", 1000000, [&]() {
+        return Response::success("User found", user.toJson()).toJson().dump().size();
+    });
+    run("  direct ApiResponse::writeJson()", 1000000, [&]() {
+        Response::RawData raw;
+        user.writeJson(raw.bytes);
+        std::string out;
+        Response::success("User found", std::move(raw)).writeJson(out);
+        return out.size();
+    });
+
+    std::cout << "Envelope with 1000 users (2K iterations)" << std::endl;
+    run("  dom    1000 x User::toJson()", 2000, [&]() {
+        nlohmann::json array = nlohmann::json::array();
+        for (const auto& u : users) {
+            array.push_back(u.toJson());
+        }
+        return Response::success("Users retrieved successfully", array).toJson().dump().size();
+    });
+    run("  direct 1000 x User::writeJson()", 2000, [&]() {
+        Response::RawData raw;
+        raw.bytes += '[';
+        for (size_t i = 0; i < users.size(); ++i) {
+            if (i > 0) raw.bytes += ',';
+            users[i].writeJson(raw.bytes);
+        }
+        raw.bytes += ']';
+        std::string out;
+        Response::success("Users retrieved successfully", std::move(raw)).writeJson(out);
+        return out.size();
+    });
+
+    const std::string body = R"({"name":"Jane Doe","email":"jane.doe@example.com","age":34})";
+
+    std::cout << "Request body parsing (1M iterations)" << std::endl;
+    run("  dom    json::parse() + User::fromJson()", 1000000, [&]() {
+        return static_cast<size_t>(User::fromJson(nlohmann::json::parse(body)).age);
+    });
+    run("  sax    UserParser::parse()", 1000000, [&]() {
+        User parsed;
+        UserParser::parse(body, parsed);
+        return static_cast<size_t>(parsed.age);
+    });
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Startup benchmark: time to recover a UserService from a snapshot plus a
+// WAL tail.
+//
+// Usage: startup_bench [users=1000000] [walRecords=100000] [dir=./startup_bench_data]
+// Build with -DBUILD_BENCHMARKS=ON and run ./bin/startup_bench 10000000
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "services/UserService.hpp"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Apply operations in bulk-sized batches so populating stays fast
+void applyInBatches(UserService& service, size_t count, BulkOperation::Type type, int firstId) {
+    std::vector<BulkOperation> batch;
+    for (size_t i = 0; i < count; ++i) {
+        int n = firstId + static_cast<int>(i);
+        User user(n, "User " + std::to_string(n), "user" + std::to_string(n) + "@example.com", 18 + n % 60);
+        batch.push_back(BulkOperation{type, user, User::ALL_FIELDS});
+        if (batch.size() == BulkParser::MAX_OPERATIONS || i + 1 == count) {
+            service.applyBulk(batch);
+            batch.clear();
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t users = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    size_t walRecords = argc > 2 ? std::stoul(argv[2]) : 100000;
+    std::string dir = argc > 3 ? argv[3] : "./startup_bench_data";
+
+    Logger::setLevel(Logger::Level::WARNING);
+    std::system(("rm -rf '" + dir + "'").c_str());
+
+    UserPersistence::Options options;
+    options.snapshotEveryRecords = 0;  // Compact explicitly below
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        UserService service;
+        service.enablePersistence(dir, options);
+        applyInBatches(service, users, BulkOperation::Type::Create, 1);
+        std::cout << "populate " << users << " users: " << secondsSince(start) << " s" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        service.compact();
+        std::cout << "snapshot: " << secondsSince(start) << " s" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        applyInBatches(service, std::min(walRecords, users), BulkOperation::Type::Update, 1);
+        std::cout << "WAL tail of " << std::min(walRecords, users) << " updates: " << secondsSince(start) << " s" << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    UserService service;
+    size_t replayed = service.enablePersistence(dir, options);
+    double elapsed = secondsSince(start);
+
+    std::cout << "restart: " << elapsed << " s (" << service.getSnapshot()->users.size()
+              << " users, " << replayed << " WAL records replayed)" << std::endl;
+
+    std::system(("rm -rf '" + dir + "'").c_str());
+    return 0;
+}
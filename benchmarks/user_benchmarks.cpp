@@ -0,0 +1,371 @@
+// Google Benchmark suite for the storage and serialization hot paths:
+// UserService operations at 1K/1M/10M users, User::toJson/fromJson, the
+// ApiResponse envelope in JSON/CBOR/MessagePack and route matching.
+//
+// Build with -DBUILD_BENCHMARKS=ON and run ./bin/benchmarks, e.g.
+//   ./bin/benchmarks --benchmark_filter=UserService
+// The 10M-user service takes a few seconds and a few GB to populate; it is
+// built once on first use and shared by every benchmark at that size.
+
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "models/User.hpp"
+#include "models/UserParser.hpp"
+#include "services/UserService.hpp"
+#include "utils/Response.hpp"
+#include "utils/Router.hpp"
+
+namespace {
+
+User makeUser(int n) {
+    return User(n, "User " + std::to_string(n), "user" + std::to_string(n) + "@example.com", 18 + n % 60);
+}
+
+void populate(UserService& service, int size) {
+    std::vector<BulkOperation> batch;
+    for (int i = 1; i <= size; ++i) {
+        batch.push_back(BulkOperation{BulkOperation::Type::Create, makeUser(i), User::ALL_FIELDS});
+        if (batch.size() == BulkParser::MAX_OPERATIONS || i == size) {
+            service.applyBulk(batch);
+            batch.clear();
+        }
+    }
+}
+
+// Service holding ids 1..size, populated once per size
+UserService& serviceWith(int size) {
+    static std::mutex mutex;
+    static std::map<int, std::unique_ptr<UserService>> services;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& service = services[size];
+    if (!service) {
+        service.reset(new UserService());
+        populate(*service, size);
+    }
+    return *service;
+}
+
+// Uniformly random existing ids, generated outside the timed loop
+std::vector<int> randomIds(int size) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(1, size);
+    std::vector<int> ids(4096);
+    for (auto& id : ids) {
+        id = pick(rng);
+    }
+    return ids;
+}
+
+void sizes(benchmark::internal::Benchmark* b) {
+    b->Arg(1000)->Arg(1000000)->Arg(10000000);
+}
+
+void BM_UserService_GetUserById(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    UserService& service = serviceWith(size);
+    auto ids = randomIds(size);
+    User user;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(service.getUserById(ids[i++ & 4095], user));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UserService_GetUserById)->Apply(sizes)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_UserService_UpdateUser(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    UserService& service = serviceWith(size);
+    auto ids = randomIds(size);
+    size_t i = 0;
+    for (auto _ : state) {
+        int id = ids[i++ & 4095];
+        benchmark::DoNotOptimize(service.updateUser(id, makeUser(id)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UserService_UpdateUser)->Apply(sizes)->ThreadRange(1, 8)->UseRealTime();
+
+// Create followed by delete keeps the table size stable across iterations.
+// Each thread uses its own email, which is free again after every delete.
+void BM_UserService_CreateDelete(benchmark::State& state) {
+    UserService& service = serviceWith(static_cast<int>(state.range(0)));
+    User user = makeUser(-1 - state.thread_index());
+    User created;
+    for (auto _ : state) {
+        service.createUser(user, created);
+        benchmark::DoNotOptimize(service.deleteUser(created.id));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_UserService_CreateDelete)->Apply(sizes)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_UserService_GetUsersPage(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    UserService& service = serviceWith(size);
+    auto ids = randomIds(size);
+    size_t i = 0;
+    for (auto _ : state) {
+        auto page = service.getUsersPage(ids[i++ & 4095], 100);
+        benchmark::DoNotOptimize(page.users.data());
+    }
+    state.SetItemsProcessed(state.iterations() * 100);
+}
+BENCHMARK(BM_UserService_GetUsersPage)->Apply(sizes);
+
+void BM_UserService_FindUserByEmail(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    UserService& service = serviceWith(size);
+    std::vector<std::string> emails;
+    for (int id : randomIds(size)) {
+        emails.push_back(makeUser(id).email);
+    }
+    User user;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(service.findUserByEmail(emails[i++ & 4095], user));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UserService_FindUserByEmail)->Apply(sizes)->ThreadRange(1, 8)->UseRealTime();
+
+// A 100-user page from a random point inside one age (ages cycle over 60 values)
+void BM_UserService_GetUsersByAge(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    UserService& service = serviceWith(size);
+    auto ids = randomIds(size);
+    size_t i = 0;
+    for (auto _ : state) {
+        int id = ids[i++ & 4095];
+        int age = 18 + id % 60;
+        auto page = service.getUsersByAge(age, 77, {age, id}, 100);
+        benchmark::DoNotOptimize(page.users.data());
+    }
+    state.SetItemsProcessed(state.iterations() * 100);
+}
+BENCHMARK(BM_UserService_GetUsersByAge)->Apply(sizes);
+
+// Snapshot rebuild cost after a write, i.e. the first full-list read
+void BM_UserService_SnapshotAfterWrite(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    UserService& service = serviceWith(size);
+    User user = makeUser(1);
+    for (auto _ : state) {
+        service.updateUser(1, user);
+        benchmark::DoNotOptimize(service.getSnapshot());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_UserService_SnapshotAfterWrite)->Apply(sizes)->Unit(benchmark::kMillisecond);
+
+// Heap bytes per user held by a freshly populated service (records, text
+// and all indexes) and by its full-list snapshot; needs glibc's mallinfo2
+void BM_UserService_MemoryPerUser(benchmark::State& state) {
+#ifdef __GLIBC__
+    auto heapInUse = [] {
+        struct mallinfo2 info = mallinfo2();
+        return info.uordblks + info.hblkhd;  // Including mmap()ed blocks
+    };
+    int size = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        size_t start = heapInUse();
+        auto service = std::make_unique<UserService>();
+        populate(*service, size);
+        size_t populated = heapInUse();
+        auto snapshot = service->getSnapshot();
+        size_t withSnapshot = heapInUse();
+
+        state.counters["store_bytes_per_user"] = static_cast<double>(populated - start) / size;
+        state.counters["snapshot_bytes_per_user"] = static_cast<double>(withSnapshot - populated) / size;
+    }
+#else
+    state.SkipWithError("needs glibc");
+#endif
+}
+BENCHMARK(BM_UserService_MemoryPerUser)->Arg(1000000)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// Current snapshot without intervening writes: a reference-count bump
+void BM_UserService_SnapshotCached(benchmark::State& state) {
+    UserService& service = serviceWith(static_cast<int>(state.range(0)));
+    service.getSnapshot();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(service.getSnapshot());
+    }
+}
+BENCHMARK(BM_UserService_SnapshotCached)->Arg(1000)->ThreadRange(1, 8)->UseRealTime();
+
+const User sampleUser(42, "Jane \"JD\" Doe", "jane.doe@example.com", 34);
+const std::string sampleBody = R"({"name":"Jane \"JD\" Doe","email":"jane.doe@example.com","age":34})";
+
+void BM_User_ToJson(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sampleUser.toJson().dump());
+    }
+}
+BENCHMARK(BM_User_ToJson);
+
+void BM_User_WriteJson(benchmark::State& state) {
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        sampleUser.writeJson(out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK(BM_User_WriteJson);
+
+void BM_User_FromJson(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(User::fromJson(nlohmann::json::parse(sampleBody)));
+    }
+}
+BENCHMARK(BM_User_FromJson);
+
+void BM_UserParser_Parse(benchmark::State& state) {
+    for (auto _ : state) {
+        User user;
+        benchmark::DoNotOptimize(UserParser::parse(sampleBody, user));
+        benchmark::DoNotOptimize(user);
+    }
+}
+BENCHMARK(BM_UserParser_Parse);
+
+// Envelope around a list of state.range(0) users
+std::vector<User> sampleUsers(int count) {
+    std::vector<User> users;
+    for (int i = 1; i <= count; ++i) {
+        users.push_back(makeUser(i));
+    }
+    return users;
+}
+
+void BM_ApiResponse_ToJson(benchmark::State& state) {
+    auto users = sampleUsers(static_cast<int>(state.range(0)));
+    nlohmann::json data = nlohmann::json::array();
+    for (const auto& user : users) {
+        data.push_back(user.toJson());
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Response::success("Users retrieved successfully", data).toJson().dump());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ApiResponse_ToJson)->Arg(1)->Arg(100)->Arg(10000);
+
+void BM_ApiResponse_WriteJson(benchmark::State& state) {
+    auto users = sampleUsers(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        Response::RawData raw;
+        raw.bytes += '[';
+        for (size_t i = 0; i < users.size(); ++i) {
+            if (i > 0) {
+                raw.bytes += ',';
+            }
+            users[i].writeJson(raw.bytes);
+        }
+        raw.bytes += ']';
+        std::string out;
+        Response::success("Users retrieved successfully", std::move(raw)).writeJson(out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ApiResponse_WriteJson)->Arg(1)->Arg(100)->Arg(10000);
+
+// Wire formats: state.range(0) selects JSON (0), CBOR (1) or MessagePack (2)
+const WireFormat::Format wireFormats[] = {
+    WireFormat::Format::Json, WireFormat::Format::Cbor, WireFormat::Format::MsgPack
+};
+
+void formatArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"format", "users"});
+    for (int format = 0; format < 3; ++format) {
+        for (int users : {1, 100, 10000}) {
+            b->Args({format, users});
+        }
+    }
+}
+
+// Envelope around state.range(1) users; "bytes" is the encoded size
+void BM_ApiResponse_Write(benchmark::State& state) {
+    WireFormat::Format format = wireFormats[state.range(0)];
+    auto users = sampleUsers(static_cast<int>(state.range(1)));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        Response::RawData raw;
+        raw.format = format;
+        if (format == WireFormat::Format::Json) {
+            raw.bytes += '[';
+            for (size_t i = 0; i < users.size(); ++i) {
+                if (i > 0) {
+                    raw.bytes += ',';
+                }
+                users[i].writeJson(raw.bytes);
+            }
+            raw.bytes += ']';
+        } else {
+            BinaryWriter::appendArrayHeader(raw.bytes, format, users.size());
+            for (const auto& user : users) {
+                user.writeBinary(raw.bytes, format);
+            }
+        }
+        std::string out;
+        Response::success("Users retrieved successfully", std::move(raw)).write(out, format);
+        bytes = out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.counters["bytes"] = static_cast<double>(bytes);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ApiResponse_Write)->Apply(formatArgs);
+
+// Request body decoding with the SAX UserParser, per format
+void BM_UserParser_ParseFormat(benchmark::State& state) {
+    WireFormat::Format format = wireFormats[state.range(0)];
+    std::string body;
+    if (format == WireFormat::Format::Json) {
+        body = sampleBody;
+    } else {
+        auto encoded = format == WireFormat::Format::Cbor ? nlohmann::json::to_cbor(nlohmann::json::parse(sampleBody))
+                                                          : nlohmann::json::to_msgpack(nlohmann::json::parse(sampleBody));
+        body.assign(encoded.begin(), encoded.end());
+    }
+    for (auto _ : state) {
+        User user;
+        benchmark::DoNotOptimize(UserParser::parse(body, user, format));
+        benchmark::DoNotOptimize(user);
+    }
+    state.counters["bytes"] = static_cast<double>(body.size());
+}
+BENCHMARK(BM_UserParser_ParseFormat)->ArgName("format")->DenseRange(0, 2);
+
+// Matching /api/users/:id with state.range(0) unrelated routes registered
+void BM_Router_Match(benchmark::State& state) {
+    Router router;
+    auto noop = [](const httplib::Request&, httplib::Response&, const Router::Params&) {};
+    for (int i = 0; i < state.range(0); ++i) {
+        router.add("GET", "/api/resource" + std::to_string(i) + "/:id", noop);
+    }
+    router.add("GET", "/api/users/:id", noop);
+
+    Router::Params params;
+    const std::string method = "GET";
+    const std::string path = "/api/users/123456";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(router.match(method, path, params));
+    }
+}
+BENCHMARK(BM_Router_Match)->Arg(8)->Arg(64)->Arg(512);
+
+}  // namespace
+
+BENCHMARK_MAIN();
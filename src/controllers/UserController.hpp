@@ -1,75 +1,842 @@
 #ifndef USER_CONTROLLER_HPP
 #define USER_CONTROLLER_HPP
 
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include "../../external/httplib.h"
 #include "../../external/nlohmann/json.hpp"
+#include "../models/UserParser.hpp"
+#include "../models/BulkOperation.hpp"
 #include "../services/UserService.hpp"
+#include "../utils/Compression.hpp"
 #include "../utils/Response.hpp"
+#include "../utils/ResponseCache.hpp"
 #include "../utils/Logger.hpp"
+#include "../utils/Metrics.hpp"
+#include "../utils/WireFormat.hpp"
 
 class UserController {
 private:
+    // Buffered GET /api/users response; nextCursor is 0 on the last page
+    struct CachedList {
+        CachedList(std::string json, int nextCursor) : body(std::move(json)), nextCursor(nextCursor) {}
+
+        Compression::Body body;
+        int nextCursor;
+    };
+
     UserService userService;
 
-    // Helper method to send JSON response
-    void sendJsonResponse(httplib::Response& res, const Response::ApiResponse& apiResponse) {
-        res.set_content(apiResponse.toJson().dump(), "application/json");
+    static constexpr size_t DEFAULT_PAGE_SIZE = 100;
+    static constexpr size_t MAX_PAGE_SIZE = 1000;
+    static constexpr size_t STREAM_BATCH_SIZE = 256;
+    static constexpr size_t USER_CACHE_ENTRIES = 65536;
+    static constexpr size_t LIST_CACHE_ENTRIES = 1024;
+    static constexpr size_t MAX_CACHED_LIST_BYTES = 1024 * 1024;
+    static constexpr size_t DEFAULT_CHANGES_LIMIT = 1000;
+    static constexpr size_t MAX_CHANGES_LIMIT = 10000;
+    static constexpr int DEFAULT_POLL_SECONDS = 30;
+    static constexpr int MAX_POLL_SECONDS = 60;
+    static constexpr std::chrono::seconds FEED_KEEPALIVE{15};
+
+    // Change feed requests currently waiting; each one holds a worker thread
+    std::atomic<size_t> feedClients{0};
+    size_t maxFeedClients = SIZE_MAX;
+
+    // Response bodies keyed by user id and format (see userCacheKey) / list
+    // query, valid for one version, together with their compressed variants
+    ResponseCache<long long, Compression::Body> userCache{USER_CACHE_ENTRIES};
+    ResponseCache<std::string, CachedList> listCache{LIST_CACHE_ENTRIES};
+
+    static constexpr WireFormat::Format FORMATS[] = {
+        WireFormat::Format::Json, WireFormat::Format::Cbor, WireFormat::Format::MsgPack
+    };
+
+    static long long userCacheKey(int id, WireFormat::Format format) {
+        return static_cast<long long>(id) * 4 + static_cast<int>(format);
+    }
+
+    // Header value without copying it; empty if the header is absent
+    static std::string_view headerValue(const httplib::Request& req, const char* key) {
+        auto found = req.headers.find(key);
+        return found == req.headers.end() ? std::string_view() : std::string_view(found->second);
+    }
+
+    static WireFormat::Format responseFormat(const httplib::Request& req) {
+        return WireFormat::fromAccept(headerValue(req, "Accept"));
+    }
+
+    static std::string serialize(const Response::ApiResponse& apiResponse, WireFormat::Format format) {
+        std::string body;
+        Metrics::ScopedTimer timer(Metrics::serialization());
+        apiResponse.write(body, format);
+        return body;
+    }
+
+    // Send apiResponse in format (JSON, CBOR or MessagePack)
+    void sendResponse(httplib::Response& res, const Response::ApiResponse& apiResponse, WireFormat::Format format) {
+        res.set_content(serialize(apiResponse, format), WireFormat::contentType(format));
         res.status = apiResponse.statusCode;
     }
 
+    // Send apiResponse in the format the client accepts
+    void sendResponse(const httplib::Request& req, httplib::Response& res, const Response::ApiResponse& apiResponse) {
+        sendResponse(res, apiResponse, responseFormat(req));
+    }
+
+    // Answer 304 if the client already holds etag
+    static bool notModified(const httplib::Request& req, httplib::Response& res, const std::string& etag) {
+        auto found = req.headers.find("If-None-Match");
+        if (found == req.headers.end() || !ETag::matches(found->second, etag)) {
+            return false;
+        }
+        res.status = 304;
+        res.set_header("ETag", etag);
+        static const std::string vary = "Accept, Accept-Encoding";  // Too long for SSO; built once
+        res.set_header("Vary", vary);
+        Metrics::recordCache(Metrics::CacheResult::NotModified);
+        return true;
+    }
+
+    // ETag of one format and encoding of a resource version; each is a
+    // separate representation and so gets its own strong tag. Written into
+    // a per-thread buffer that stays valid until the next call.
+    static const std::string& makeETag(std::string_view resource, uint64_t version, WireFormat::Format format,
+                                       Compression::Encoding encoding) {
+        thread_local std::string etag;
+        char variant[32];
+        int length = std::snprintf(variant, sizeof(variant), "%s%s%s", WireFormat::tag(format),
+                                   *WireFormat::tag(format) && encoding != Compression::Encoding::Identity ? "-" : "",
+                                   Compression::name(encoding));
+        ETag::make(etag, resource, version, std::string_view(variant, static_cast<size_t>(std::max(length, 0))));
+        return etag;
+    }
+
+    static void sendTagged(httplib::Response& res, const std::string& etag, std::shared_ptr<const Compression::Body> body,
+                           WireFormat::Format format, Compression::Encoding encoding) {
+        res.set_header("ETag", etag);
+        res.set_header("Vary", "Accept");
+        Compression::send(res, std::move(body), encoding, WireFormat::contentType(format));
+        res.status = 200;
+    }
+
+    // Serialize a single user for the response "data" member
+    static Response::RawData userData(const User& user, WireFormat::Format format, unsigned fields = User::ALL_FIELDS) {
+        Response::RawData raw;
+        raw.format = format;
+        user.write(raw.bytes, format, fields);
+        return raw;
+    }
+
+    // Serialize a list of users (a vector of User or UserColumns) as an array
+    template <typename Users>
+    static Response::RawData usersData(const Users& users, WireFormat::Format format, unsigned fields) {
+        Metrics::ScopedTimer timer(Metrics::serialization());
+        Response::RawData raw;
+        raw.format = format;
+        raw.bytes.reserve(users.size() * 64 + 5);
+        if (format == WireFormat::Format::Json) {
+            raw.bytes += '[';
+            for (size_t i = 0; i < users.size(); ++i) {
+                if (i > 0) {
+                    raw.bytes += ',';
+                }
+                users[i].writeJson(raw.bytes, fields);
+            }
+            raw.bytes += ']';
+        } else {
+            BinaryWriter::appendArrayHeader(raw.bytes, format, users.size());
+            for (size_t i = 0; i < users.size(); ++i) {
+                users[i].writeBinary(raw.bytes, format, fields);
+            }
+        }
+        return raw;
+    }
+
+    // Bulk validation errors as [{"index":i,"message":"..."}]
+    static Response::RawData bulkErrorsData(const std::vector<std::pair<size_t, std::string>>& problems,
+                                            WireFormat::Format format) {
+        Response::RawData raw;
+        raw.format = format;
+        if (format == WireFormat::Format::Json) {
+            raw.bytes += '[';
+            for (size_t i = 0; i < problems.size(); ++i) {
+                if (i > 0) {
+                    raw.bytes += ',';
+                }
+                raw.bytes += '{';
+                JsonWriter::appendKey(raw.bytes, "index");
+                JsonWriter::appendInt(raw.bytes, static_cast<long long>(problems[i].first));
+                raw.bytes += ',';
+                JsonWriter::appendKey(raw.bytes, "message");
+                JsonWriter::appendString(raw.bytes, problems[i].second);
+                raw.bytes += '}';
+            }
+            raw.bytes += ']';
+        } else {
+            BinaryWriter::appendArrayHeader(raw.bytes, format, problems.size());
+            for (const auto& problem : problems) {
+                BinaryWriter::appendMapHeader(raw.bytes, format, 2);
+                BinaryWriter::appendKey(raw.bytes, format, "index");
+                BinaryWriter::appendInt(raw.bytes, format, static_cast<long long>(problem.first));
+                BinaryWriter::appendKey(raw.bytes, format, "message");
+                BinaryWriter::appendString(raw.bytes, format, problem.second);
+            }
+        }
+        return raw;
+    }
+
+    // Bulk results as [{"id":n,"status":s}]
+    static Response::RawData bulkResultsData(const std::vector<BulkResult>& results, WireFormat::Format format) {
+        Response::RawData raw;
+        raw.format = format;
+        raw.bytes.reserve(results.size() * 24 + 5);
+        if (format == WireFormat::Format::Json) {
+            raw.bytes += '[';
+            for (size_t i = 0; i < results.size(); ++i) {
+                if (i > 0) {
+                    raw.bytes += ',';
+                }
+                raw.bytes += '{';
+                JsonWriter::appendKey(raw.bytes, "id");
+                JsonWriter::appendInt(raw.bytes, results[i].id);
+                raw.bytes += ',';
+                JsonWriter::appendKey(raw.bytes, "status");
+                JsonWriter::appendInt(raw.bytes, results[i].status);
+                raw.bytes += '}';
+            }
+            raw.bytes += ']';
+        } else {
+            BinaryWriter::appendArrayHeader(raw.bytes, format, results.size());
+            for (const auto& result : results) {
+                BinaryWriter::appendMapHeader(raw.bytes, format, 2);
+                BinaryWriter::appendKey(raw.bytes, format, "id");
+                BinaryWriter::appendInt(raw.bytes, format, result.id);
+                BinaryWriter::appendKey(raw.bytes, format, "status");
+                BinaryWriter::appendInt(raw.bytes, format, result.status);
+            }
+        }
+        return raw;
+    }
+
+    static const char* changeName(ChangeLog::Type type) {
+        switch (type) {
+            case ChangeLog::Type::Create: return "create";
+            case ChangeLog::Type::Update: return "update";
+            default: return "delete";
+        }
+    }
+
+    // Change feed page as {"changes":[...],"next":seq}. Creates and updates
+    // are {"op":...,"seq":s,"user":{...}}, deletes {"id":n,"op":"delete","seq":s}.
+    static Response::RawData changesData(const std::vector<ChangeLog::Change>& changes, uint64_t next,
+                                         WireFormat::Format format) {
+        Response::RawData raw;
+        raw.format = format;
+        raw.bytes.reserve(changes.size() * 96 + 32);
+        if (format == WireFormat::Format::Json) {
+            raw.bytes += '{';
+            JsonWriter::appendKey(raw.bytes, "changes");
+            raw.bytes += '[';
+            for (size_t i = 0; i < changes.size(); ++i) {
+                const auto& change = changes[i];
+                raw.bytes += i > 0 ? ",{" : "{";
+                if (change.type == ChangeLog::Type::Delete) {
+                    JsonWriter::appendKey(raw.bytes, "id");
+                    JsonWriter::appendInt(raw.bytes, change.user.id);
+                    raw.bytes += ',';
+                }
+                JsonWriter::appendKey(raw.bytes, "op");
+                JsonWriter::appendString(raw.bytes, changeName(change.type));
+                raw.bytes += ',';
+                JsonWriter::appendKey(raw.bytes, "seq");
+                JsonWriter::appendInt(raw.bytes, static_cast<long long>(change.seq));
+                if (change.type != ChangeLog::Type::Delete) {
+                    raw.bytes += ',';
+                    JsonWriter::appendKey(raw.bytes, "user");
+                    change.user.writeJson(raw.bytes);
+                }
+                raw.bytes += '}';
+            }
+            raw.bytes += "],";
+            JsonWriter::appendKey(raw.bytes, "next");
+            JsonWriter::appendInt(raw.bytes, static_cast<long long>(next));
+            raw.bytes += '}';
+        } else {
+            BinaryWriter::appendMapHeader(raw.bytes, format, 2);
+            BinaryWriter::appendKey(raw.bytes, format, "changes");
+            BinaryWriter::appendArrayHeader(raw.bytes, format, changes.size());
+            for (const auto& change : changes) {
+                BinaryWriter::appendMapHeader(raw.bytes, format, 3);
+                if (change.type == ChangeLog::Type::Delete) {
+                    BinaryWriter::appendKey(raw.bytes, format, "id");
+                    BinaryWriter::appendInt(raw.bytes, format, change.user.id);
+                }
+                BinaryWriter::appendKey(raw.bytes, format, "op");
+                BinaryWriter::appendString(raw.bytes, format, changeName(change.type));
+                BinaryWriter::appendKey(raw.bytes, format, "seq");
+                BinaryWriter::appendInt(raw.bytes, format, static_cast<long long>(change.seq));
+                if (change.type != ChangeLog::Type::Delete) {
+                    BinaryWriter::appendKey(raw.bytes, format, "user");
+                    change.user.writeBinary(raw.bytes, format);
+                }
+            }
+            BinaryWriter::appendKey(raw.bytes, format, "next");
+            BinaryWriter::appendInt(raw.bytes, format, static_cast<long long>(next));
+        }
+        return raw;
+    }
+
+    static bool parseSequence(const std::string& value, uint64_t& out) {
+        auto end = value.data() + value.size();
+        auto parsed = std::from_chars(value.data(), end, out);
+        return !value.empty() && parsed.ec == std::errc() && parsed.ptr == end;
+    }
+
+    bool acquireFeedClient() {
+        if (feedClients.fetch_add(1, std::memory_order_relaxed) >= maxFeedClients) {
+            feedClients.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    void releaseFeedClient() {
+        feedClients.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void sendResync(httplib::Response& res, WireFormat::Format format) {
+        uint64_t latest = userService.changes().latest();
+        sendResponse(res, Response::ApiResponse(false, "Resync required",
+                                                nlohmann::json{{"next", latest}}, 410), format);
+        Logger::warning("GET /api/users/changes - Resync required");
+    }
+
+    // Server-Sent Events branch of GET /api/users/changes: one event per
+    // change ("id: <seq>", "event: <op>", "data: <user JSON>"), a comment
+    // line every FEED_KEEPALIVE while idle, and a final "resync" event if
+    // the client falls behind the log.
+    void streamChanges(httplib::Response& res, uint64_t since) {
+        if (!acquireFeedClient()) {
+            res.set_header("Retry-After", "1");
+            sendResponse(res, Response::ApiResponse(false, "Too many change feed clients",
+                                                    nlohmann::json::object(), 503), WireFormat::Format::Json);
+            Logger::warning("GET /api/users/changes - Too many change feed clients");
+            return;
+        }
+
+        struct StreamState {
+            uint64_t since;
+            std::vector<ChangeLog::Change> batch;
+            std::string buffer;
+        };
+        auto state = std::make_shared<StreamState>();
+        state->since = since;
+
+        res.status = 200;
+        res.set_header("Cache-Control", "no-store");
+        res.set_chunked_content_provider("text/event-stream",
+            [this, state](size_t, httplib::DataSink& sink) {
+                ChangeLog& log = userService.changes();
+                if (!log.wait(state->since, FEED_KEEPALIVE)) {
+                    if (log.isClosed()) {
+                        sink.done();
+                        return true;
+                    }
+                    static const char keepalive[] = ": keepalive\n\n";
+                    return sink.write(keepalive, sizeof(keepalive) - 1);
+                }
+
+                std::string& buffer = state->buffer;
+                buffer.clear();
+                state->batch.clear();
+                if (!log.read(state->since, STREAM_BATCH_SIZE, state->batch)) {
+                    buffer = "event: resync\ndata: {\"next\":" + std::to_string(log.latest()) + "}\n\n";
+                    bool written = sink.write(buffer.data(), buffer.size());
+                    sink.done();
+                    return written;
+                }
+
+                for (const auto& change : state->batch) {
+                    buffer += "id: ";
+                    buffer += std::to_string(change.seq);
+                    buffer += "\nevent: ";
+                    buffer += changeName(change.type);
+                    buffer += "\ndata: ";
+                    if (change.type == ChangeLog::Type::Delete) {
+                        change.user.writeJson(buffer, User::FIELD_ID);
+                    } else {
+                        change.user.writeJson(buffer);
+                    }
+                    buffer += "\n\n";
+                }
+                state->since = state->batch.back().seq;
+                return sink.write(buffer.data(), buffer.size());
+            },
+            [this](bool) { releaseFeedClient(); });
+
+        Logger::info("GET /api/users/changes - Streaming changes after ", since);
+    }
+
+    // The shared store used by --workers has fixed-width name/email fields
+    bool fitsStore(const User& user) const {
+        size_t limit = userService.maxFieldLength();
+        return user.name.size() <= limit && user.email.size() <= limit;
+    }
+
+    std::string fieldLengthMessage() const {
+        return "Name and email must be at most " + std::to_string(userService.maxFieldLength()) + " bytes";
+    }
+
+    // Parse a POST/PUT body (JSON, CBOR or MessagePack by Content-Type) into
+    // user, sending the 400/422 response on failure
+    bool parseUserBody(const httplib::Request& req, httplib::Response& res, User& user, const std::string& route) {
+        auto format = WireFormat::fromContentType(headerValue(req, "Content-Type"));
+        switch (UserParser::parse(req.body, user, format)) {
+            case UserParser::Result::Ok:
+                if (!fitsStore(user)) {
+                    Logger::warning(route, " - Fields too long for the store");
+                    sendResponse(req, res, Response::validationError(fieldLengthMessage()));
+                    return false;
+                }
+                return true;
+            case UserParser::Result::SyntaxError:
+                Logger::error(route, " - ", WireFormat::name(format), " parse error");
+                sendResponse(req, res, Response::badRequest(std::string("Invalid ") + WireFormat::name(format) + " format"));
+                return false;
+            case UserParser::Result::TooLarge:
+                Logger::error(route, " - Request body too large");
+                sendResponse(req, res, Response::badRequest("Request body too large"));
+                return false;
+            case UserParser::Result::SchemaError:
+            default:
+                Logger::warning(route, " - Validation failed");
+                sendResponse(req, res, Response::validationError("Invalid user data. Name, email, and age are required."));
+                return false;
+        }
+    }
+
+    // Parse a non-negative integer query parameter without exceptions
+    static bool parseIntParam(const std::string& value, int& out) {
+        if (value.empty() || value.size() > 10) {
+            return false;
+        }
+        long long result = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            result = result * 10 + (c - '0');
+        }
+        if (result > INT_MAX) {
+            return false;
+        }
+        out = static_cast<int>(result);
+        return true;
+    }
+
+    // Streaming branch of GET /api/users. Users are serialized from a store
+    // snapshot in batches straight into the chunked response, so peak memory
+    // is one batch regardless of table size. NDJSON emits one user per line;
+    // otherwise the output is byte-identical to the buffered JSON envelope.
+    void streamUsers(httplib::Response& res, unsigned fields, bool ndjson) {
+        struct StreamState {
+            std::shared_ptr<const UserService::Snapshot> snapshot;
+            size_t next = 0;
+            bool started = false;
+            std::string buffer;
+        };
+
+        auto state = std::make_shared<StreamState>();
+        state->snapshot = userService.getSnapshot();
+        size_t total = state->snapshot->users.size();
+
+        res.status = 200;
+        res.set_chunked_content_provider(
+            ndjson ? "application/x-ndjson" : "application/json",
+            [state, fields, ndjson](size_t, httplib::DataSink& sink) {
+                const auto& users = state->snapshot->users;
+                std::string& buffer = state->buffer;
+                buffer.clear();
+
+                if (!state->started) {
+                    state->started = true;
+                    if (!ndjson && !users.empty()) {
+                        buffer += "{\"data\":[";
+                    }
+                }
+
+                Metrics::ScopedTimer timer(Metrics::serialization());
+                size_t end = std::min(state->next + STREAM_BATCH_SIZE, users.size());
+                for (size_t i = state->next; i < end; ++i) {
+                    if (!ndjson && i > 0) {
+                        buffer += ',';
+                    }
+                    users[i].writeJson(buffer, fields);
+                    if (ndjson) {
+                        buffer += '\n';
+                    }
+                }
+                state->next = end;
+
+                bool finished = state->next == users.size();
+                if (finished && !ndjson) {
+                    if (!users.empty()) {
+                        buffer += "],";
+                    } else {
+                        buffer += "{";
+                    }
+                    buffer += "\"message\":\"Users retrieved successfully\",\"success\":true}";
+                }
+
+                if (!buffer.empty() && !sink.write(buffer.data(), buffer.size())) {
+                    return false;
+                }
+                if (finished) {
+                    sink.done();
+                }
+                return true;
+            });
+
+        Logger::info("GET /api/users - Streaming ", total, " users");
+    }
+
+    // Cursor-paginated branch of GET /api/users
+    void getUsersPage(const httplib::Request& req, httplib::Response& res, unsigned fields) {
+        int limit = static_cast<int>(DEFAULT_PAGE_SIZE);
+        int after = 0;
+
+        if ((req.has_param("limit") && (!parseIntParam(req.get_param_value("limit"), limit) || limit == 0)) ||
+            (req.has_param("after") && !parseIntParam(req.get_param_value("after"), after))) {
+            sendResponse(req, res, Response::badRequest("Invalid pagination parameters"));
+            Logger::warning("GET /api/users - Invalid pagination parameters");
+            return;
+        }
+
+        size_t pageSize = std::min(static_cast<size_t>(limit), MAX_PAGE_SIZE);
+        auto format = responseFormat(req);
+        auto encoding = Compression::negotiate(req);
+        uint64_t version = userService.getVersion();
+        const std::string& etag = makeETag("list", version, format, encoding);
+        if (notModified(req, res, etag)) {
+            Logger::info("GET /api/users - Page not modified");
+            return;
+        }
+
+        std::string key = std::string(WireFormat::tag(format)) + ':' + std::to_string(fields) + ':' +
+                          std::to_string(after) + ':' + std::to_string(pageSize);
+        auto cached = listCache.get(key, version);
+        if (cached) {
+            Metrics::recordCache(Metrics::CacheResult::Hit);
+        } else {
+            Metrics::recordCache(Metrics::CacheResult::Miss);
+            auto page = userService.getUsersPage(after, pageSize);
+            auto built = std::make_shared<CachedList>(
+                serialize(Response::success("Users retrieved successfully", usersData(page.users, format, fields)), format),
+                page.hasMore && !page.users.empty() ? page.users.back().id : 0);
+
+            // The page is read without a global lock; only keep it if no
+            // write landed while it was built. Otherwise it may or may not
+            // include that write, so it keeps the older tag: revalidating
+            // with it gets a fresh page rather than a 304.
+            if (userService.getVersion() == version) {
+                listCache.put(key, version, built);
+            }
+            cached = built;
+        }
+
+        if (cached->nextCursor != 0) {
+            res.set_header("X-Next-Cursor", std::to_string(cached->nextCursor));
+        }
+        sendTagged(res, etag, std::shared_ptr<const Compression::Body>(cached, &cached->body), format, encoding);
+
+        Logger::info("GET /api/users - Successfully returned a page of users");
+    }
+
+    // Parse an age query cursor, "<age>:<id>"
+    static bool parseAgeCursor(const std::string& value, std::pair<int, int>& out) {
+        size_t colon = value.find(':');
+        return colon != std::string::npos && parseIntParam(value.substr(0, colon), out.first) &&
+               parseIntParam(value.substr(colon + 1), out.second);
+    }
+
+    // Indexed query branch of GET /api/users: ?email= and/or ?age_min= /
+    // ?age_max=. Results are not cached; they are cheap to build from the
+    // indexes and the parameter space is unbounded.
+    void queryUsers(const httplib::Request& req, httplib::Response& res, unsigned fields) {
+        int minAge = 0;
+        int maxAge = INT_MAX;
+        int limit = static_cast<int>(DEFAULT_PAGE_SIZE);
+        std::pair<int, int> after(INT_MIN, INT_MIN);
+        bool byAge = req.has_param("age_min") || req.has_param("age_max");
+
+        if ((req.has_param("age_min") && !parseIntParam(req.get_param_value("age_min"), minAge)) ||
+            (req.has_param("age_max") && !parseIntParam(req.get_param_value("age_max"), maxAge)) ||
+            (req.has_param("limit") && (!parseIntParam(req.get_param_value("limit"), limit) || limit == 0)) ||
+            (req.has_param("after") && !parseAgeCursor(req.get_param_value("after"), after))) {
+            sendResponse(req, res, Response::badRequest("Invalid query parameters"));
+            Logger::warning("GET /api/users - Invalid query parameters");
+            return;
+        }
+        if (minAge > maxAge) {
+            sendResponse(req, res, Response::badRequest("Invalid age range"));
+            Logger::warning("GET /api/users - Invalid age range");
+            return;
+        }
+
+        auto format = responseFormat(req);
+        auto encoding = Compression::negotiate(req);
+        uint64_t version = userService.getVersion();
+        const std::string& etag = makeETag("list", version, format, encoding);
+        if (notModified(req, res, etag)) {
+            Logger::info("GET /api/users - Query not modified");
+            return;
+        }
+
+        std::vector<User> users;
+        if (req.has_param("email")) {
+            User user;
+            if (userService.findUserByEmail(req.get_param_value("email"), user) &&
+                (!byAge || (user.age >= minAge && user.age <= maxAge))) {
+                users.push_back(std::move(user));
+            }
+        } else {
+            auto page = userService.getUsersByAge(minAge, maxAge, after,
+                                                  std::min(static_cast<size_t>(limit), MAX_PAGE_SIZE));
+            if (page.hasMore && !page.users.empty()) {
+                const User& last = page.users.back();
+                res.set_header("X-Next-Cursor", std::to_string(last.age) + ":" + std::to_string(last.id));
+            }
+            users = std::move(page.users);
+        }
+
+        // As for pages, a result that raced a write keeps the older tag
+        auto body = std::make_shared<const Compression::Body>(
+            serialize(Response::success("Users retrieved successfully", usersData(users, format, fields)), format));
+        sendTagged(res, etag, body, format, encoding);
+        Logger::info("GET /api/users - Query returned ", users.size(), " users");
+    }
+
 public:
+    UserService& getUserService() {
+        return userService;
+    }
+
+    // Limit change feed requests that may wait at once (long-polls and
+    // streams each hold a worker thread while waiting)
+    void setMaxFeedClients(size_t clients) {
+        maxFeedClients = clients;
+    }
+
+    // GET /api/users/changes - Change feed
+    //   ?since=<seq>   changes after seq, oldest first, with "next" to pass as
+    //                  the following since; without since, just the current
+    //                  position
+    //   ?limit=N       at most N changes (default 1000, max 10000)
+    //   ?timeout=S     long-poll: wait up to S seconds (default 30, max 60;
+    //                  0 = never) for a change when there is none yet; a
+    //                  long-poll beyond the waiting-client limit returns
+    //                  at once, a stream beyond it gets 503
+    //   Accept: text/event-stream
+    //                  Server-Sent Events instead; Last-Event-ID resumes
+    //   A since older than the change log (or from an earlier run) gets 410
+    //   "Resync required" with the current "next": re-read GET /api/users,
+    //   then follow the feed from there.
+    void getChanges(const httplib::Request& req, httplib::Response& res) {
+        try {
+            ChangeLog& log = userService.changes();
+            if (!log.enabled()) {
+                sendResponse(req, res, Response::ApiResponse(false, "Change feed is disabled", nlohmann::json::object(), 501));
+                Logger::warning("GET /api/users/changes - Change feed is disabled");
+                return;
+            }
+
+            bool sse = headerValue(req, "Accept").find("text/event-stream") != std::string_view::npos;
+            std::string sinceValue = req.has_header("Last-Event-ID") ? req.get_header_value("Last-Event-ID")
+                                                                      : req.get_param_value("since");
+            uint64_t since = 0;
+            int limit = static_cast<int>(DEFAULT_CHANGES_LIMIT);
+            int timeout = DEFAULT_POLL_SECONDS;
+            if ((!sinceValue.empty() && !parseSequence(sinceValue, since)) ||
+                (req.has_param("limit") && (!parseIntParam(req.get_param_value("limit"), limit) || limit == 0)) ||
+                (req.has_param("timeout") && !parseIntParam(req.get_param_value("timeout"), timeout))) {
+                sendResponse(req, res, Response::badRequest("Invalid change feed parameters"));
+                Logger::warning("GET /api/users/changes - Invalid parameters");
+                return;
+            }
+            if (sinceValue.empty()) {
+                since = log.latest();
+            }
+
+            if (sse) {
+                streamChanges(res, since);
+                return;
+            }
+
+            auto format = responseFormat(req);
+            size_t pageSize = std::min(static_cast<size_t>(limit), MAX_CHANGES_LIMIT);
+            std::vector<ChangeLog::Change> changes;
+            if (!log.read(since, pageSize, changes)) {
+                sendResync(res, format);
+                return;
+            }
+            if (changes.empty() && !sinceValue.empty() && timeout > 0 && acquireFeedClient()) {
+                log.wait(since, std::chrono::seconds(std::min(timeout, MAX_POLL_SECONDS)));
+                releaseFeedClient();
+                if (!log.read(since, pageSize, changes)) {
+                    sendResync(res, format);
+                    return;
+                }
+            }
+
+            uint64_t next = changes.empty() ? since : changes.back().seq;
+            res.set_header("Cache-Control", "no-store");
+            sendResponse(res, Response::success("Changes retrieved successfully", changesData(changes, next, format)), format);
+            Logger::info("GET /api/users/changes - Returned ", changes.size(), " changes");
+        }
+        catch (const std::exception& e) {
+            Logger::error("GET /api/users/changes - Error: ", e.what());
+            sendResponse(req, res, Response::internalError("Failed to retrieve changes"));
+        }
+    }
+
+    // Storage shard sizes and lock contention, reported by /health
+    nlohmann::json getStorageStats() const {
+        nlohmann::json shards = nlohmann::json::array();
+        for (const auto& shard : userService.getShardStats()) {
+            shards.push_back({{"users", shard.users}, {"contended", shard.contended}});
+        }
+        return shards;
+    }
+
     // GET /api/users - Get all users
+    //   ?limit=N&after=<id>  cursor pagination in id order; X-Next-Cursor holds
+    //                        the cursor for the next page when there is one
+    //   ?email=<address>     the user with this email (case-insensitive)
+    //   ?age_min=A&age_max=B users with A <= age <= B in (age, id) order,
+    //                        paged with limit and after=<age>:<id> cursors
+    //   ?fields=id,email     only serialize the listed fields
+    //   ?stream=true         chunked JSON, same bytes as the buffered response
+    //   Accept: application/x-ndjson
+    //                        chunked NDJSON, one user per line
+    //   Accept: application/cbor or application/msgpack
+    //                        buffered responses in that format; streaming
+    //                        responses are always JSON
     void getAllUsers(const httplib::Request& req, httplib::Response& res) {
         try {
             Logger::info("GET /api/users - Fetching all users");
-            
-            auto users = userService.getAllUsers();
-            nlohmann::json usersJson = nlohmann::json::array();
-            
-            for (const auto& user : users) {
-                usersJson.push_back(user.toJson());
+
+            unsigned fields = User::ALL_FIELDS;
+            if (req.has_param("fields") && !User::parseFields(req.get_param_value("fields"), fields)) {
+                sendResponse(req, res, Response::badRequest("Invalid fields parameter"));
+                Logger::warning("GET /api/users - Invalid fields parameter");
+                return;
+            }
+
+            if (req.has_param("email") || req.has_param("age_min") || req.has_param("age_max")) {
+                queryUsers(req, res, fields);
+                return;
+            }
+
+            bool ndjson = headerValue(req, "Accept").find("application/x-ndjson") != std::string_view::npos;
+            if (ndjson || req.get_param_value("stream") == "true") {
+                streamUsers(res, fields, ndjson);
+                return;
+            }
+
+            if (req.has_param("limit") || req.has_param("after")) {
+                getUsersPage(req, res, fields);
+                return;
             }
             
-            auto response = Response::success("Users retrieved successfully", usersJson);
-            sendJsonResponse(res, response);
+            auto format = responseFormat(req);
+            auto encoding = Compression::negotiate(req);
+            if (notModified(req, res, makeETag("list", userService.getVersion(), format, encoding))) {
+                Logger::info("GET /api/users - Not modified");
+                return;
+            }
+
+            // Shared, immutable view: no lock held and no User copies made
+            auto snapshot = userService.getSnapshot();
+            std::string key = std::string(WireFormat::tag(format)) + ':' + std::to_string(fields);
+            auto cached = listCache.get(key, snapshot->version);
+            if (cached) {
+                Metrics::recordCache(Metrics::CacheResult::Hit);
+            } else {
+                Metrics::recordCache(Metrics::CacheResult::Miss);
+                auto built = std::make_shared<CachedList>(
+                    serialize(Response::success("Users retrieved successfully", usersData(snapshot->users, format, fields)), format), 0);
+                if (built->body.size() <= MAX_CACHED_LIST_BYTES) {
+                    listCache.put(key, snapshot->version, built);
+                }
+                cached = built;
+            }
+            sendTagged(res, makeETag("list", snapshot->version, format, encoding),
+                       std::shared_ptr<const Compression::Body>(cached, &cached->body), format, encoding);
             
-            Logger::info("GET /api/users - Successfully returned " + std::to_string(users.size()) + " users");
+            Logger::info("GET /api/users - Successfully returned ", snapshot->users.size(), " users");
         }
         catch (const std::exception& e) {
-            Logger::error("GET /api/users - Error: " + std::string(e.what()));
+            Logger::error("GET /api/users - Error: ", e.what());
             auto response = Response::internalError("Failed to retrieve users");
-            sendJsonResponse(res, response);
+            sendResponse(req, res, response);
         }
     }
 
     // GET /api/users/:id - Get user by ID
-    void getUserById(const httplib::Request& req, httplib::Response& res) {
+    //   Responses carry an ETag; If-None-Match with the current tag gets 304.
+    //   An unchanged user is served from the response cache.
+    void getUserById(const httplib::Request& req, httplib::Response& res, int id) {
         try {
-            std::string idStr = req.matches[1].str();
-            int id = std::stoi(idStr);
-            
-            Logger::info("GET /api/users/" + idStr + " - Fetching user by ID");
+            char resource[16];
+            auto idEnd = std::to_chars(resource, resource + sizeof(resource), id).ptr;
+            std::string_view idStr(resource, static_cast<size_t>(idEnd - resource));
+
+            Logger::info("GET /api/users/", id, " - Fetching user by ID");
             
-            auto user = userService.getUserById(id);
-            if (user) {
-                auto response = Response::success("User found", user->toJson());
-                sendJsonResponse(res, response);
-                Logger::info("GET /api/users/" + idStr + " - User found and returned");
+            uint64_t version = 0;
+            if (!userService.getUserVersion(id, version)) {
+                sendResponse(req, res, Response::notFound("User not found"));
+                Logger::warning("GET /api/users/", id, " - User not found");
+                return;
+            }
+            auto format = responseFormat(req);
+            auto encoding = Compression::negotiate(req);
+            const std::string& etag = makeETag(idStr, version, format, encoding);
+            if (notModified(req, res, etag)) {
+                Logger::info("GET /api/users/", id, " - Not modified");
+                return;
+            }
+
+            auto body = userCache.get(userCacheKey(id, format), version);
+            if (body) {
+                Metrics::recordCache(Metrics::CacheResult::Hit);
             } else {
-                auto response = Response::notFound("User not found");
-                sendJsonResponse(res, response);
-                Logger::warning("GET /api/users/" + idStr + " - User not found");
+                Metrics::recordCache(Metrics::CacheResult::Miss);
+                User user;
+                if (!userService.getUserById(id, user)) {
+                    // Deleted since the version check
+                    sendResponse(req, res, Response::notFound("User not found"));
+                    Logger::warning("GET /api/users/", id, " - User not found");
+                    return;
+                }
+                body = std::make_shared<const Compression::Body>(
+                    serialize(Response::success("User found", userData(user, format)), format));
+                userCache.put(userCacheKey(id, format), user.version, body);
+                if (user.version != version) {
+                    makeETag(idStr, user.version, format, encoding);  // Rewrites etag in place
+                }
             }
-        }
-        catch (const std::invalid_argument& e) {
-            Logger::error("GET /api/users/:id - Invalid ID format");
-            auto response = Response::badRequest("Invalid user ID format");
-            sendJsonResponse(res, response);
+            sendTagged(res, etag, body, format, encoding);
+            Logger::info("GET /api/users/", id, " - User found and returned");
         }
         catch (const std::exception& e) {
-            Logger::error("GET /api/users/:id - Error: " + std::string(e.what()));
+            Logger::error("GET /api/users/:id - Error: ", e.what());
             auto response = Response::internalError("Failed to retrieve user");
-            sendJsonResponse(res, response);
+            sendResponse(req, res, response);
         }
     }
 
@@ -78,107 +845,175 @@ public:
         try {
             Logger::info("POST /api/users - Creating new user");
             
-            auto json = nlohmann::json::parse(req.body);
-            User user = User::fromJson(json);
+            User user;
+            if (!parseUserBody(req, res, user, "POST /api/users")) {
+                return;
+            }
             
             if (!user.isValid()) {
                 auto response = Response::validationError("Invalid user data. Name, email, and age are required.");
-                sendJsonResponse(res, response);
+                sendResponse(req, res, response);
                 Logger::warning("POST /api/users - Validation failed");
                 return;
             }
             
-            User createdUser = userService.createUser(user);
-            auto response = Response::created("User created successfully", createdUser.toJson());
-            sendJsonResponse(res, response);
+            User createdUser;
+            WriteResult result = userService.createUser(user, createdUser);
+            if (result == WriteResult::Conflict) {
+                sendResponse(req, res, Response::conflict("Email already exists"));
+                Logger::warning("POST /api/users - Email already exists");
+                return;
+            }
+            if (result == WriteResult::Full) {
+                sendResponse(req, res, Response::insufficientStorage("User store is full"));
+                Logger::warning("POST /api/users - User store is full");
+                return;
+            }
+            auto format = responseFormat(req);
+            auto response = Response::created("User created successfully", userData(createdUser, format));
+            sendResponse(res, response, format);
             
-            Logger::info("POST /api/users - User created with ID: " + std::to_string(createdUser.id));
-        }
-        catch (const nlohmann::json::parse_error& e) {
-            Logger::error("POST /api/users - JSON parse error: " + std::string(e.what()));
-            auto response = Response::badRequest("Invalid JSON format");
-            sendJsonResponse(res, response);
+            Logger::info("POST /api/users - User created with ID: ", createdUser.id);
         }
         catch (const std::exception& e) {
-            Logger::error("POST /api/users - Error: " + std::string(e.what()));
+            Logger::error("POST /api/users - Error: ", e.what());
             auto response = Response::internalError("Failed to create user");
-            sendJsonResponse(res, response);
+            sendResponse(req, res, response);
         }
     }
 
     // PUT /api/users/:id - Update user
-    void updateUser(const httplib::Request& req, httplib::Response& res) {
+    void updateUser(const httplib::Request& req, httplib::Response& res, int id) {
         try {
-            std::string idStr = req.matches[1].str();
-            int id = std::stoi(idStr);
+            std::string idStr = std::to_string(id);
             
-            Logger::info("PUT /api/users/" + idStr + " - Updating user");
+            Logger::info("PUT /api/users/", id, " - Updating user");
             
-            auto json = nlohmann::json::parse(req.body);
-            User updatedUser = User::fromJson(json);
+            User updatedUser;
+            if (!parseUserBody(req, res, updatedUser, "PUT /api/users/" + idStr)) {
+                return;
+            }
             
             if (!updatedUser.isValid()) {
                 auto response = Response::validationError("Invalid user data. Name, email, and age are required.");
-                sendJsonResponse(res, response);
-                Logger::warning("PUT /api/users/" + idStr + " - Validation failed");
+                sendResponse(req, res, response);
+                Logger::warning("PUT /api/users/", id, " - Validation failed");
                 return;
             }
             
-            if (userService.updateUser(id, updatedUser)) {
+            WriteResult result = userService.updateUser(id, updatedUser);
+            if (result == WriteResult::Conflict) {
+                sendResponse(req, res, Response::conflict("Email already exists"));
+                Logger::warning("PUT /api/users/", id, " - Email already exists");
+            } else if (result == WriteResult::Full) {
+                sendResponse(req, res, Response::insufficientStorage("User store is full"));
+                Logger::warning("PUT /api/users/", id, " - User store is full");
+            } else if (result == WriteResult::Ok) {
                 updatedUser.id = id;
-                auto response = Response::success("User updated successfully", updatedUser.toJson());
-                sendJsonResponse(res, response);
-                Logger::info("PUT /api/users/" + idStr + " - User updated successfully");
+                auto format = responseFormat(req);
+                auto response = Response::success("User updated successfully", userData(updatedUser, format));
+                sendResponse(res, response, format);
+                Logger::info("PUT /api/users/", id, " - User updated successfully");
             } else {
                 auto response = Response::notFound("User not found");
-                sendJsonResponse(res, response);
-                Logger::warning("PUT /api/users/" + idStr + " - User not found");
+                sendResponse(req, res, response);
+                Logger::warning("PUT /api/users/", id, " - User not found");
             }
         }
-        catch (const std::invalid_argument& e) {
-            Logger::error("PUT /api/users/:id - Invalid ID format");
-            auto response = Response::badRequest("Invalid user ID format");
-            sendJsonResponse(res, response);
+        catch (const std::exception& e) {
+            Logger::error("PUT /api/users/:id - Error: ", e.what());
+            auto response = Response::internalError("Failed to update user");
+            sendResponse(req, res, response);
         }
-        catch (const nlohmann::json::parse_error& e) {
-            Logger::error("PUT /api/users/:id - JSON parse error: " + std::string(e.what()));
-            auto response = Response::badRequest("Invalid JSON format");
-            sendJsonResponse(res, response);
+    }
+
+    // POST /api/users/_bulk - Apply many create/update/delete operations
+    //   Body is a JSON array, NDJSON with Content-Type: application/x-ndjson,
+    //   or a CBOR / MessagePack array with the matching Content-Type.
+    //   Every operation is validated before any is applied; results are
+    //   returned per operation, in request order.
+    void bulkUsers(const httplib::Request& req, httplib::Response& res) {
+        try {
+            std::string_view contentType = headerValue(req, "Content-Type");
+            bool ndjson = contentType.find("application/x-ndjson") != std::string_view::npos;
+            auto inputFormat = WireFormat::fromContentType(contentType);
+            auto format = responseFormat(req);
+
+            std::vector<BulkOperation> ops;
+            size_t errorIndex = 0;
+            switch (BulkParser::parse(req.body, ndjson, ops, errorIndex, inputFormat)) {
+                case BulkParser::Result::Ok:
+                    break;
+                case BulkParser::Result::SyntaxError:
+                    Logger::error("POST /api/users/_bulk - ", WireFormat::name(inputFormat), " parse error in operation ",
+                                  errorIndex);
+                    sendResponse(res, Response::badRequest(std::string("Invalid ") + WireFormat::name(inputFormat) + " format"), format);
+                    return;
+                case BulkParser::Result::TooLarge:
+                    Logger::error("POST /api/users/_bulk - Request too large");
+                    sendResponse(res, Response::badRequest("Bulk request too large (max " +
+                        std::to_string(BulkParser::MAX_OPERATIONS) + " operations)"), format);
+                    return;
+                case BulkParser::Result::SchemaError:
+                default:
+                    Logger::warning("POST /api/users/_bulk - Malformed operation ", errorIndex);
+                    sendResponse(res, Response::validationError("Malformed operation at index " + std::to_string(errorIndex)), format);
+                    return;
+            }
+
+            // Validate everything up front so a bad item never leaves a partial import
+            std::vector<std::pair<size_t, std::string>> problems;
+            for (size_t i = 0; i < ops.size(); ++i) {
+                std::string problem = ops[i].validate();
+                if (problem.empty() && ops[i].type != BulkOperation::Type::Delete && !fitsStore(ops[i].user)) {
+                    problem = fieldLengthMessage();
+                }
+                if (!problem.empty()) {
+                    problems.emplace_back(i, std::move(problem));
+                }
+            }
+
+            if (!problems.empty()) {
+                sendResponse(res, Response::ApiResponse(false, "Validation Error: Invalid bulk operations",
+                                                        bulkErrorsData(problems, format), 422), format);
+                Logger::warning("POST /api/users/_bulk - Validation failed");
+                return;
+            }
+
+            auto results = userService.applyBulk(ops);
+            sendResponse(res, Response::success("Bulk operations applied", bulkResultsData(results, format)), format);
+            Logger::info("POST /api/users/_bulk - Applied ", ops.size(), " operations");
         }
         catch (const std::exception& e) {
-            Logger::error("PUT /api/users/:id - Error: " + std::string(e.what()));
-            auto response = Response::internalError("Failed to update user");
-            sendJsonResponse(res, response);
+            Logger::error("POST /api/users/_bulk - Error: ", e.what());
+            sendResponse(req, res, Response::internalError("Failed to apply bulk operations"));
         }
     }
 
     // DELETE /api/users/:id - Delete user
-    void deleteUser(const httplib::Request& req, httplib::Response& res) {
+    void deleteUser(const httplib::Request& req, httplib::Response& res, int id) {
         try {
-            std::string idStr = req.matches[1].str();
-            int id = std::stoi(idStr);
+            std::string idStr = std::to_string(id);
             
-            Logger::info("DELETE /api/users/" + idStr + " - Deleting user");
+            Logger::info("DELETE /api/users/", id, " - Deleting user");
             
             if (userService.deleteUser(id)) {
+                for (auto format : FORMATS) {
+                    userCache.erase(userCacheKey(id, format));
+                }
                 auto response = Response::success("User deleted successfully");
-                sendJsonResponse(res, response);
-                Logger::info("DELETE /api/users/" + idStr + " - User deleted successfully");
+                sendResponse(req, res, response);
+                Logger::info("DELETE /api/users/", id, " - User deleted successfully");
             } else {
                 auto response = Response::notFound("User not found");
-                sendJsonResponse(res, response);
-                Logger::warning("DELETE /api/users/" + idStr + " - User not found");
+                sendResponse(req, res, response);
+                Logger::warning("DELETE /api/users/", id, " - User not found");
             }
         }
-        catch (const std::invalid_argument& e) {
-            Logger::error("DELETE /api/users/:id - Invalid ID format");
-            auto response = Response::badRequest("Invalid user ID format");
-            sendJsonResponse(res, response);
-        }
         catch (const std::exception& e) {
-            Logger::error("DELETE /api/users/:id - Error: " + std::string(e.what()));
+            Logger::error("DELETE /api/users/:id - Error: ", e.what());
             auto response = Response::internalError("Failed to delete user");
-            sendJsonResponse(res, response);
+            sendResponse(req, res, response);
         }
     }
 };
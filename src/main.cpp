@@ -1,61 +1,133 @@
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 #include "../external/httplib.h"
 #include "controllers/UserController.hpp"
+#include "utils/AdmissionControl.hpp"
+#include "utils/Compression.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Router.hpp"
+#include "utils/ServerConfig.hpp"
 
 class RestServer {
 private:
     httplib::Server server;
+    Router router;
+    AdmissionControl admission;
     UserController userController;
+    ServerConfig config;
     int port;
+    socket_t listenSocket = INVALID_SOCKET;
 
 public:
-    RestServer(int port = 8080) : port(port) {
+    RestServer(const ServerConfig& config = ServerConfig()) : config(config), port(config.port) {
+        setupServerOptions();
         setupRoutes();
         setupMiddleware();
     }
 
+    // Worker pool, admission control, keep-alive, timeouts, socket options
+    // and compression from config
+    void setupServerOptions() {
+        size_t threads = config.threads;
+        size_t queueLimit = config.queueLimit;
+        server.new_task_queue = [threads, queueLimit] {
+            return new AdmissionControl::TimedQueue(new httplib::ThreadPool(threads, queueLimit));
+        };
+
+        AdmissionControl::Options admissionOptions;
+        admissionOptions.maxConcurrency = config.maxConcurrency();
+        admissionOptions.minConcurrency = config.minConcurrency();
+        admissionOptions.queueDeadline = static_cast<uint64_t>(config.queueDeadlineMs) * 1000000;
+        admissionOptions.adaptive = config.adaptiveConcurrency;
+        admission.configure(admissionOptions);
+        router.setFilter([this](const httplib::Request& req, httplib::Response& res) {
+            return admission.admit(req, res);
+        });
+
+        server.set_keep_alive_max_count(config.keepAliveMaxCount);
+        server.set_keep_alive_timeout(config.keepAliveTimeout);
+        server.set_read_timeout(config.readTimeout);
+        server.set_write_timeout(config.writeTimeout);
+        server.set_payload_max_length(config.payloadMaxLength);
+        server.set_tcp_nodelay(config.tcpNoDelay);
+        Compression::setMinSize(config.compressionMinSize);
+        userController.getUserService().changes().setCapacity(config.changeLogSize);
+        userController.setMaxFeedClients(std::max<size_t>(1, threads / 2));
+
+        // Remember the listening socket so start() can apply the backlog
+        server.set_socket_options([this](socket_t sock) {
+            httplib::default_socket_options(sock);
+            listenSocket = sock;
+        });
+    }
+
     void setupMiddleware() {
-        // CORS middleware
-        server.set_pre_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+        // CORS headers, then routing: requests without a body are served here
+        server.set_pre_routing_handler([this](const httplib::Request& req, httplib::Response& res) {
+            Metrics::beginRequest();
             res.set_header("Access-Control-Allow-Origin", "*");
             res.set_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
             res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
-            return httplib::Server::HandlerResponse::Unhandled;
-        });
 
-        // Handle OPTIONS requests for CORS preflight
-        server.Options(".*", [](const httplib::Request& req, httplib::Response& res) {
-            return;
+            // CORS preflight for any path
+            if (req.method == "OPTIONS") {
+                return httplib::Server::HandlerResponse::Handled;
+            }
+            return router.dispatch(req, res);
         });
 
-        // Request logging middleware
-        server.set_logger([](const httplib::Request& req, const httplib::Response& res) {
-            Logger::info(req.method + " " + req.path + " - " + std::to_string(res.status));
+        // Request logging and latency metrics; called after the response is written
+        server.set_logger([this](const httplib::Request& req, const httplib::Response& res) {
+            admission.finish();
+            Metrics::endRequest(req.method, req.path, res.status);
+            Logger::info(req.method, ' ', req.path, " - ", res.status);
         });
     }
 
     void setupRoutes() {
+        using Params = Router::Params;
+
         // Health check endpoint
-        server.Get("/health", [](const httplib::Request& req, httplib::Response& res) {
+        router.add("GET", "/health", [this](const httplib::Request&, httplib::Response& res, const Params&) {
             nlohmann::json response;
             response["status"] = "healthy";
             response["timestamp"] = std::time(nullptr);
             response["service"] = "C++ REST API";
+            response["storage"] = {{"shards", userController.getStorageStats()}};
+            response["logging"] = {{"droppedRecords", Logger::droppedRecords()}};
+            response["server"] = config.toJson();
             res.set_content(response.dump(), "application/json");
         });
 
+        // Prometheus metrics endpoint
+        router.add("GET", "/metrics", [](const httplib::Request&, httplib::Response& res, const Params&) {
+            res.set_content(Metrics::render(), "text/plain; version=0.0.4");
+        });
+
         // API info endpoint
-        server.Get("/api", [](const httplib::Request& req, httplib::Response& res) {
+        router.add("GET", "/api", [](const httplib::Request&, httplib::Response& res, const Params&) {
             nlohmann::json response;
             response["message"] = "Welcome to C++ REST API";
             response["version"] = "1.0.0";
             response["endpoints"] = {
                 {"GET /health", "Health check"},
+                {"GET /metrics", "Prometheus metrics"},
                 {"GET /api/users", "Get all users"},
+                {"GET /api/users/changes", "Change feed (long-poll or Server-Sent Events)"},
                 {"GET /api/users/:id", "Get user by ID"},
                 {"POST /api/users", "Create new user"},
+                {"POST /api/users/_bulk", "Bulk create/update/delete users"},
                 {"PUT /api/users/:id", "Update user"},
                 {"DELETE /api/users/:id", "Delete user"}
             };
@@ -63,28 +135,42 @@ public:
         });
 
         // User routes
-        server.Get("/api/users", [this](const httplib::Request& req, httplib::Response& res) {
+        router.add("GET", "/api/users", [this](const httplib::Request& req, httplib::Response& res, const Params&) {
             userController.getAllUsers(req, res);
         });
 
-        server.Get(R"(/api/users/(\d+))", [this](const httplib::Request& req, httplib::Response& res) {
-            userController.getUserById(req, res);
+        router.add("GET", "/api/users/changes", [this](const httplib::Request& req, httplib::Response& res, const Params&) {
+            userController.getChanges(req, res);
+        });
+
+        router.add("GET", "/api/users/:id", [this](const httplib::Request& req, httplib::Response& res, const Params& params) {
+            userController.getUserById(req, res, params[0]);
         });
 
-        server.Post("/api/users", [this](const httplib::Request& req, httplib::Response& res) {
+        router.add("POST", "/api/users", [this](const httplib::Request& req, httplib::Response& res, const Params&) {
             userController.createUser(req, res);
         });
 
-        server.Put(R"(/api/users/(\d+))", [this](const httplib::Request& req, httplib::Response& res) {
-            userController.updateUser(req, res);
+        router.add("POST", "/api/users/_bulk", [this](const httplib::Request& req, httplib::Response& res, const Params&) {
+            userController.bulkUsers(req, res);
         });
 
-        server.Delete(R"(/api/users/(\d+))", [this](const httplib::Request& req, httplib::Response& res) {
-            userController.deleteUser(req, res);
+        router.add("PUT", "/api/users/:id", [this](const httplib::Request& req, httplib::Response& res, const Params& params) {
+            userController.updateUser(req, res, params[0]);
         });
 
-        // 404 handler
+        router.add("DELETE", "/api/users/:id", [this](const httplib::Request& req, httplib::Response& res, const Params& params) {
+            userController.deleteUser(req, res, params[0]);
+        });
+
+        // Requests with a body reach the router once httplib has read it
+        router.install(server);
+
+        // 404 handler (only for responses that have no body of their own)
         server.set_error_handler([](const httplib::Request& req, httplib::Response& res) {
+            if (!res.body.empty()) {
+                return;
+            }
             nlohmann::json response;
             response["success"] = false;
             response["message"] = "Endpoint not found";
@@ -93,13 +179,37 @@ public:
         });
     }
 
+    // Serve users from a store shared with the other worker processes
+    void useSharedStore(std::shared_ptr<SharedUserStore> store) {
+        userController.getUserService().useSharedStore(std::move(store));
+    }
+
+    // Load users from dataDir and write-ahead log every change to it
+    void enablePersistence(const std::string& dataDir, UserPersistence::Options options) {
+        auto started = std::chrono::steady_clock::now();
+        size_t replayed = userController.getUserService().enablePersistence(dataDir, options);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        Logger::info("Recovered users from " + dataDir + " (" + std::to_string(replayed) +
+                     " WAL records replayed) in " + std::to_string(elapsed.count()) + " ms");
+    }
+
     void start() {
         Logger::info("Starting C++ REST API server on port " + std::to_string(port));
+        Logger::info("Server settings: " + config.toJson().dump());
         Logger::info("Health check available at: http://localhost:" + std::to_string(port) + "/health");
         Logger::info("API info available at: http://localhost:" + std::to_string(port) + "/api");
         Logger::info("Users API available at: http://localhost:" + std::to_string(port) + "/api/users");
         
-        if (!server.listen("0.0.0.0", port)) {
+        if (!server.bind_to_port("0.0.0.0", port)) {
+            Logger::error("Failed to start server on port " + std::to_string(port));
+            throw std::runtime_error("Failed to start server");
+        }
+
+        // httplib listens with a compile-time backlog; listening again resizes
+        // the accept queue (Windows keeps the original value)
+        ::listen(listenSocket, config.listenBacklog);
+
+        if (!server.listen_after_bind()) {
             Logger::error("Failed to start server on port " + std::to_string(port));
             throw std::runtime_error("Failed to start server");
         }
@@ -107,6 +217,7 @@ public:
 
     void stop() {
         Logger::info("Stopping server...");
+        userController.getUserService().changes().close();  // Release waiting change feed clients
         server.stop();
     }
 };
@@ -122,22 +233,128 @@ void signalHandler(int signal) {
     exit(0);
 }
 
+#ifndef _WIN32
+// --workers N: the parent forks N server processes and only supervises them.
+// Each worker binds the port itself; SO_REUSEPORT (httplib's default socket
+// option) lets the kernel spread connections across them.
+std::vector<pid_t> workerPids;
+volatile std::sig_atomic_t stoppingWorkers = 0;
+
+void stopWorkers(int) {
+    stoppingWorkers = 1;
+    for (pid_t pid : workerPids) {
+        kill(pid, SIGTERM);
+    }
+}
+
+// Returns true in a worker, false in the parent once all workers are forked
+bool spawnWorkers(int count) {
+    std::cout.flush();
+    for (int i = 0; i < count; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            stopWorkers(0);
+            throw std::runtime_error("fork failed: " + std::string(std::strerror(errno)));
+        }
+        if (pid == 0) {
+            workerPids.clear();
+            return true;
+        }
+        workerPids.push_back(pid);
+    }
+    return false;
+}
+
+// Wait for the workers. Any worker exiting on its own (crash, bind failure)
+// stops the rest: it may have died holding a shared store lock.
+int superviseWorkers() {
+    std::signal(SIGINT, stopWorkers);
+    std::signal(SIGTERM, stopWorkers);
+
+    int exitCode = 0;
+    while (!workerPids.empty()) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        workerPids.erase(std::remove(workerPids.begin(), workerPids.end(), pid), workerPids.end());
+
+        if (!stoppingWorkers) {
+            Logger::error("Worker " + std::to_string(pid) + " exited unexpectedly; stopping all workers");
+            exitCode = 1;
+            stopWorkers(0);
+        }
+    }
+    Logger::info("All workers stopped");
+    return exitCode;
+}
+#endif
+
 int main(int argc, char* argv[]) {
     try {
         // Setup signal handlers for graceful shutdown
         std::signal(SIGINT, signalHandler);
         std::signal(SIGTERM, signalHandler);
 
-        // Parse command line arguments for port
-        int port = 8080;
-        if (argc > 1) {
-            port = std::stoi(argv[1]);
+        // Server settings: config file, SERVER_* environment variables and
+        // --flag=value arguments (see ServerConfig)
+        ServerConfig config = ServerConfig::load(argc, argv);
+
+        // Logging: LOG_LEVEL=debug|info|warn|error, LOG_ASYNC=1 for the
+        // background writer
+        Logger::Level level;
+        const char* levelEnv = std::getenv("LOG_LEVEL");
+        if (levelEnv && Logger::parseLevel(levelEnv, level)) {
+            Logger::setLevel(level);
+        }
+        const char* dataDir = std::getenv("DATA_DIR");
+
+        // Multi-process mode: create the shared store, then fork. Workers
+        // continue below as ordinary servers; no threads exist before fork.
+        std::shared_ptr<SharedUserStore> sharedStore;
+        if (config.workers > 1) {
+#ifdef _WIN32
+            throw std::runtime_error("--workers is not supported on Windows");
+#else
+            if (dataDir && *dataDir) {
+                throw std::invalid_argument("DATA_DIR cannot be combined with --workers");
+            }
+            sharedStore = std::make_shared<SharedUserStore>(config.sharedCapacity, UserService::defaultShardCount());
+            Logger::info("Starting " + std::to_string(config.workers) + " worker processes sharing a store of " +
+                         std::to_string(sharedStore->totalCapacity()) + " users");
+            if (!spawnWorkers(config.workers)) {
+                return superviseWorkers();
+            }
+#endif
+        }
+
+        const char* asyncEnv = std::getenv("LOG_ASYNC");
+        if (asyncEnv && std::string(asyncEnv) == "1") {
+            Logger::startAsync();
         }
 
         Logger::info("Initializing C++ REST API Server");
         
-        RestServer server(port);
+        RestServer server(config);
         globalServer = &server;
+
+        if (sharedStore) {
+            server.useSharedStore(sharedStore);
+        }
+
+        // Persistence: DATA_DIR enables the WAL, SNAPSHOT_EVERY sets how many
+        // WAL records trigger a snapshot
+        if (dataDir && *dataDir) {
+            UserPersistence::Options options;
+            if (const char* every = std::getenv("SNAPSHOT_EVERY")) {
+                options.snapshotEveryRecords = std::stoul(every);
+            }
+            server.enablePersistence(dataDir, options);
+        }
         
         server.start();
         
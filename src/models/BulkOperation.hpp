@@ -0,0 +1,191 @@
+#ifndef BULK_OPERATION_HPP
+#define BULK_OPERATION_HPP
+
+#include <string>
+#include <vector>
+#include "../../external/nlohmann/json.hpp"
+#include "User.hpp"
+#include "UserParser.hpp"
+
+// One entry of a POST /api/users/_bulk request
+struct BulkOperation {
+    enum class Type {
+        Create,
+        Update,
+        Delete
+    };
+
+    Type type;
+    User user;        // For update/delete, user.id is the target
+    unsigned fields;  // User::Field bits present in the request
+
+    // Empty string if the operation is well-formed, otherwise the reason
+    std::string validate() const {
+        const unsigned required = User::FIELD_NAME | User::FIELD_EMAIL | User::FIELD_AGE;
+
+        if (type != Type::Create && !(fields & User::FIELD_ID)) {
+            return "Missing user id";
+        }
+        if (type != Type::Delete && ((fields & required) != required || !user.isValid())) {
+            return "Invalid user data. Name, email, and age are required.";
+        }
+        return "";
+    }
+};
+
+// Outcome of one bulk operation, as an HTTP-style status
+struct BulkResult {
+    int id;
+    int status;  // 201 created, 200 updated/deleted, 404 not found, 409 email taken
+};
+
+// Outcome of a single create or update
+enum class WriteResult {
+    Ok,
+    NotFound,
+    Conflict,  // Another user has the same email
+    Full       // No room left in the shared store
+};
+
+// Single-pass parser for bulk request bodies.
+//
+// Accepts either an array (JSON, CBOR or MessagePack) or NDJSON (one object
+// per line) of flat operation objects:
+//   {"op":"create","name":"...","email":"...","age":30}
+//   {"op":"update","id":7,"name":"...","email":"...","age":31}
+//   {"op":"delete","id":7}
+// Built on UserParser::FieldHandler, so user members follow exactly the same
+// rules as single-user requests.
+class BulkParser {
+public:
+    using Result = UserParser::Result;
+
+    static constexpr size_t MAX_BODY_SIZE = 64 * 1024 * 1024;
+    static constexpr size_t MAX_OPERATIONS = 100000;
+
+    // On failure, errorIndex is the index of the operation being parsed.
+    // A CBOR or MessagePack body must hold an array of operations.
+    static Result parse(const std::string& body, bool ndjson,
+                        std::vector<BulkOperation>& ops, size_t& errorIndex,
+                        WireFormat::Format format = WireFormat::Format::Json) {
+        ops.clear();
+        errorIndex = 0;
+        if (body.size() > MAX_BODY_SIZE) {
+            return Result::TooLarge;
+        }
+
+        Handler handler(ops, ndjson ? 1 : 2);
+        if (!ndjson) {
+            Result result = finish(handler, nlohmann::json::sax_parse(body, &handler, WireFormat::inputFormat(format)));
+            errorIndex = ops.size();
+            if (result == Result::Ok && !handler.sawArray) {
+                return Result::SchemaError;
+            }
+            return result;
+        }
+
+        size_t start = 0;
+        while (start < body.size()) {
+            size_t end = body.find('\n', start);
+            if (end == std::string::npos) {
+                end = body.size();
+            }
+
+            if (body.find_first_not_of(" \t\r", start) < end) {
+                Result result = finish(handler, nlohmann::json::sax_parse(body.begin() + start, body.begin() + end, &handler));
+                if (result != Result::Ok) {
+                    errorIndex = ops.size();
+                    return result;
+                }
+            }
+            start = end + 1;
+        }
+        return Result::Ok;
+    }
+
+private:
+    struct Handler : UserParser::FieldHandler {
+        static constexpr unsigned OP_KEY = 1u << 8;
+
+        std::vector<BulkOperation>& ops;
+        User scratch;
+        bool hasType = false;
+        BulkOperation::Type type = BulkOperation::Type::Create;
+        bool sawArray = false;
+        bool tooMany = false;
+
+        Handler(std::vector<BulkOperation>& ops, int objectDepth)
+            : UserParser::FieldHandler(scratch), ops(ops) {
+            this->objectDepth = objectDepth;
+        }
+
+        bool start_object(std::size_t) {
+            if (++depth != objectDepth) {
+                return fail();
+            }
+            if (ops.size() >= MAX_OPERATIONS) {
+                tooMany = true;
+                return false;
+            }
+            scratch = User();
+            seen = 0;
+            hasType = false;
+            return true;
+        }
+
+        bool end_object() {
+            if (depth-- == objectDepth) {
+                if (!hasType) {
+                    return fail();
+                }
+                ops.push_back(BulkOperation{type, scratch, seen});
+            }
+            return true;
+        }
+
+        bool start_array(std::size_t) {
+            if (objectDepth != 2 || depth != 0) {
+                return fail();
+            }
+            sawArray = true;
+            ++depth;
+            return true;
+        }
+
+        bool end_array() {
+            --depth;
+            return true;
+        }
+
+        bool key(json::string_t& name) {
+            if (depth == objectDepth && name == "op") {
+                current = OP_KEY;
+                return true;
+            }
+            return UserParser::FieldHandler::key(name);
+        }
+
+        bool string(json::string_t& value) {
+            if (current != OP_KEY) {
+                return UserParser::FieldHandler::string(value);
+            }
+
+            current = 0;
+            hasType = true;
+            if (value == "create") type = BulkOperation::Type::Create;
+            else if (value == "update") type = BulkOperation::Type::Update;
+            else if (value == "delete") type = BulkOperation::Type::Delete;
+            else return fail();
+            return true;
+        }
+    };
+
+    static Result finish(const Handler& handler, bool ok) {
+        if (handler.syntaxError) return Result::SyntaxError;
+        if (handler.tooMany) return Result::TooLarge;
+        if (!ok || handler.schemaError) return Result::SchemaError;
+        return Result::Ok;
+    }
+};
+
+#endif // BULK_OPERATION_HPP
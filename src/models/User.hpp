@@ -2,19 +2,35 @@
 #define USER_HPP
 
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include "../../external/nlohmann/json.hpp"
+#include "../utils/BinaryWriter.hpp"
+#include "../utils/JsonWriter.hpp"
+
+struct UserView;
 
 class User {
 public:
+    // Field bits for projected serialization (?fields=id,email)
+    enum Field : unsigned {
+        FIELD_ID = 1u << 0,
+        FIELD_NAME = 1u << 1,
+        FIELD_EMAIL = 1u << 2,
+        FIELD_AGE = 1u << 3,
+        ALL_FIELDS = FIELD_ID | FIELD_NAME | FIELD_EMAIL | FIELD_AGE
+    };
+
     int id;
     std::string name;
     std::string email;
     int age;
+    uint64_t version;  // Store version of the last change to this user; not serialized
 
-    User() : id(0), age(0) {}
+    User() : id(0), age(0), version(0) {}
     
     User(int id, const std::string& name, const std::string& email, int age)
-        : id(id), name(name), email(email), age(age) {}
+        : id(id), name(name), email(email), age(age), version(0) {}
 
     // Validation method
     bool isValid() const {
@@ -31,6 +47,73 @@ public:
         };
     }
 
+    // JSON serialization restricted to the given Field bits
+    nlohmann::json toJson(unsigned fields) const {
+        if (fields == ALL_FIELDS) {
+            return toJson();
+        }
+
+        nlohmann::json j = nlohmann::json::object();
+        if (fields & FIELD_ID) j["id"] = id;
+        if (fields & FIELD_NAME) j["name"] = name;
+        if (fields & FIELD_EMAIL) j["email"] = email;
+        if (fields & FIELD_AGE) j["age"] = age;
+        return j;
+    }
+
+    // Non-owning view of this user's fields
+    UserView view() const;
+
+    // Append this user as JSON without building a DOM. Byte-identical to
+    // toJson(fields).dump(); keys are written in the same sorted order.
+    void writeJson(std::string& out, unsigned fields = ALL_FIELDS) const;
+
+    // Append this user as CBOR or MessagePack; byte-identical to
+    // to_cbor / to_msgpack of toJson(fields)
+    void writeBinary(std::string& out, WireFormat::Format format, unsigned fields = ALL_FIELDS) const;
+
+    // Append this user in format
+    void write(std::string& out, WireFormat::Format format, unsigned fields = ALL_FIELDS) const;
+
+    // Key for the email index and uniqueness checks: surrounding whitespace
+    // removed and ASCII letters lowercased
+    static std::string normalizeEmail(std::string_view email) {
+        size_t first = email.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos) {
+            return std::string();
+        }
+        size_t last = email.find_last_not_of(" \t\r\n");
+        std::string key(email.substr(first, last - first + 1));
+        for (char& c : key) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        return key;
+    }
+
+    // Parse a comma-separated field list; fails on unknown or missing names
+    static bool parseFields(const std::string& list, unsigned& fields) {
+        fields = 0;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(',', start);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+
+            std::string field = list.substr(start, end - start);
+            if (field == "id") fields |= FIELD_ID;
+            else if (field == "name") fields |= FIELD_NAME;
+            else if (field == "email") fields |= FIELD_EMAIL;
+            else if (field == "age") fields |= FIELD_AGE;
+            else return false;
+
+            start = end + 1;
+        }
+        return fields != 0;
+    }
+
     // JSON deserialization
     static User fromJson(const nlohmann::json& j) {
         User user;
@@ -46,4 +129,110 @@ public:
     }
 };
 
+// Read-only view of a user's fields, pointing into whatever storage holds
+// them (a User, or a UserColumns record). Valid until that storage changes.
+// All user serialization is implemented here.
+struct UserView {
+    int id;
+    std::string_view name;
+    std::string_view email;
+    int age;
+    uint64_t version;
+
+    User toUser() const {
+        User user(id, std::string(name), std::string(email), age);
+        user.version = version;
+        return user;
+    }
+
+    // Copy into an existing User, reusing its strings' capacity
+    void copyTo(User& user) const {
+        user.id = id;
+        user.name.assign(name.data(), name.size());
+        user.email.assign(email.data(), email.size());
+        user.age = age;
+        user.version = version;
+    }
+
+    void writeJson(std::string& out, unsigned fields = User::ALL_FIELDS) const {
+        bool first = true;
+        auto separator = [&out, &first]() {
+            if (!first) out += ',';
+            first = false;
+        };
+
+        out += '{';
+        if (fields & User::FIELD_AGE) {
+            separator();
+            JsonWriter::appendKey(out, "age");
+            JsonWriter::appendInt(out, age);
+        }
+        if (fields & User::FIELD_EMAIL) {
+            separator();
+            JsonWriter::appendKey(out, "email");
+            JsonWriter::appendString(out, email);
+        }
+        if (fields & User::FIELD_ID) {
+            separator();
+            JsonWriter::appendKey(out, "id");
+            JsonWriter::appendInt(out, id);
+        }
+        if (fields & User::FIELD_NAME) {
+            separator();
+            JsonWriter::appendKey(out, "name");
+            JsonWriter::appendString(out, name);
+        }
+        out += '}';
+    }
+
+    void writeBinary(std::string& out, WireFormat::Format format, unsigned fields = User::ALL_FIELDS) const {
+        size_t count = 0;
+        for (unsigned bits = fields & User::ALL_FIELDS; bits != 0; bits &= bits - 1) {
+            ++count;
+        }
+
+        BinaryWriter::appendMapHeader(out, format, count);
+        if (fields & User::FIELD_AGE) {
+            BinaryWriter::appendKey(out, format, "age");
+            BinaryWriter::appendInt(out, format, age);
+        }
+        if (fields & User::FIELD_EMAIL) {
+            BinaryWriter::appendKey(out, format, "email");
+            BinaryWriter::appendString(out, format, email);
+        }
+        if (fields & User::FIELD_ID) {
+            BinaryWriter::appendKey(out, format, "id");
+            BinaryWriter::appendInt(out, format, id);
+        }
+        if (fields & User::FIELD_NAME) {
+            BinaryWriter::appendKey(out, format, "name");
+            BinaryWriter::appendString(out, format, name);
+        }
+    }
+
+    void write(std::string& out, WireFormat::Format format, unsigned fields = User::ALL_FIELDS) const {
+        if (format == WireFormat::Format::Json) {
+            writeJson(out, fields);
+        } else {
+            writeBinary(out, format, fields);
+        }
+    }
+};
+
+inline UserView User::view() const {
+    return UserView{id, name, email, age, version};
+}
+
+inline void User::writeJson(std::string& out, unsigned fields) const {
+    view().writeJson(out, fields);
+}
+
+inline void User::writeBinary(std::string& out, WireFormat::Format format, unsigned fields) const {
+    view().writeBinary(out, format, fields);
+}
+
+inline void User::write(std::string& out, WireFormat::Format format, unsigned fields) const {
+    view().write(out, format, fields);
+}
+
 #endif // USER_HPP
\ No newline at end of file
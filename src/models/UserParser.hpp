@@ -0,0 +1,159 @@
+#ifndef USER_PARSER_HPP
+#define USER_PARSER_HPP
+
+#include <string>
+#include <cmath>
+#include <limits>
+#include "../../external/nlohmann/json.hpp"
+#include "User.hpp"
+#include "../utils/JsonWriter.hpp"
+#include "../utils/WireFormat.hpp"
+
+// Single-pass, schema-driven parser for User request bodies.
+//
+// Drives nlohmann's SAX interface and fills a User directly instead of
+// building a DOM and then calling User::fromJson. The body must be a flat
+// object whose members are only "id", "name", "email" and "age"; anything
+// else (unknown keys, nested values, wrong types, oversized strings) stops
+// the parse at the offending token. No exceptions are thrown for bad input.
+//
+// Strings must be valid UTF-8 in every format. nlohmann's JSON lexer checks
+// that, but its CBOR and MessagePack readers pass the bytes through, and a
+// stored invalid string would make every later JSON response for that user
+// throw; so the handler checks them itself.
+class UserParser {
+public:
+    enum class Result {
+        Ok,
+        SyntaxError,   // Not well-formed JSON (or CBOR / MessagePack)
+        SchemaError,   // Well-formed, but not a valid user object
+        TooLarge       // Body exceeds MAX_BODY_SIZE
+    };
+
+    static constexpr size_t MAX_BODY_SIZE = 16 * 1024;
+    static constexpr size_t MAX_STRING_LENGTH = 1024;
+
+    // body is JSON, or CBOR / MessagePack when format says so; the same
+    // handler validates all three
+    static Result parse(const std::string& body, User& user,
+                        WireFormat::Format format = WireFormat::Format::Json) {
+        if (body.size() > MAX_BODY_SIZE) {
+            return Result::TooLarge;
+        }
+
+        FieldHandler handler(user);
+        bool ok = nlohmann::json::sax_parse(body, &handler, WireFormat::inputFormat(format));
+        if (handler.syntaxError) {
+            return Result::SyntaxError;
+        }
+        if (!ok || handler.schemaError) {
+            return Result::SchemaError;
+        }
+
+        // Same required fields as User::fromJson
+        const unsigned required = User::FIELD_NAME | User::FIELD_EMAIL | User::FIELD_AGE;
+        return (handler.seen & required) == required ? Result::Ok : Result::SchemaError;
+    }
+
+    // SAX handler that assigns User members from the object at objectDepth.
+    // Other parsers (e.g. BulkParser) extend it to embed users in larger
+    // documents.
+    struct FieldHandler {
+        using json = nlohmann::json;
+
+        User* user;
+        int depth = 0;
+        int objectDepth = 1;   // Nesting level of the user object
+        unsigned current = 0;  // Field bit of the pending key
+        unsigned seen = 0;
+        bool syntaxError = false;
+        bool schemaError = false;
+
+        explicit FieldHandler(User& user) : user(&user) {}
+
+        bool fail() {
+            schemaError = true;
+            return false;
+        }
+
+        // Integer fields accept the same values json::get<int> does
+        bool setInt(long long value) {
+            if (depth != objectDepth || !(current & (User::FIELD_ID | User::FIELD_AGE))) {
+                return fail();
+            }
+            int narrowed = static_cast<int>(value);
+            if (current == User::FIELD_ID) {
+                user->id = narrowed;
+            } else {
+                user->age = narrowed;
+            }
+            seen |= current;
+            current = 0;
+            return true;
+        }
+
+        bool null() { return fail(); }
+        bool boolean(bool value) { return setInt(value ? 1 : 0); }
+        bool number_integer(json::number_integer_t value) { return setInt(value); }
+        bool number_unsigned(json::number_unsigned_t value) { return setInt(static_cast<long long>(value)); }
+
+        bool number_float(json::number_float_t value, const json::string_t&) {
+            if (!std::isfinite(value) || std::fabs(value) > std::numeric_limits<int>::max()) {
+                return fail();
+            }
+            return setInt(static_cast<long long>(value));
+        }
+
+        bool string(json::string_t& value) {
+            if (depth != objectDepth || value.size() > MAX_STRING_LENGTH) {
+                return fail();
+            }
+            if (!JsonWriter::isValidUtf8(value)) {
+                // Reported like the JSON lexer reports it
+                syntaxError = true;
+                return false;
+            }
+            if (current == User::FIELD_NAME) {
+                user->name = std::move(value);
+            } else if (current == User::FIELD_EMAIL) {
+                user->email = std::move(value);
+            } else {
+                return fail();
+            }
+            seen |= current;
+            current = 0;
+            return true;
+        }
+
+        bool binary(json::binary_t&) { return fail(); }
+
+        bool start_object(std::size_t) {
+            // Only the user object itself is allowed
+            return ++depth == objectDepth ? true : fail();
+        }
+
+        bool key(json::string_t& name) {
+            if (name == "id") current = User::FIELD_ID;
+            else if (name == "name") current = User::FIELD_NAME;
+            else if (name == "email") current = User::FIELD_EMAIL;
+            else if (name == "age") current = User::FIELD_AGE;
+            else return fail();
+            return true;
+        }
+
+        bool end_object() {
+            --depth;
+            return true;
+        }
+
+        bool start_array(std::size_t) { return fail(); }
+        bool end_array() { return fail(); }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+            syntaxError = true;
+            return false;
+        }
+    };
+};
+
+#endif // USER_PARSER_HPP
@@ -0,0 +1,272 @@
+#ifndef CHANGE_LOG_HPP
+#define CHANGE_LOG_HPP
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include "../models/User.hpp"
+
+// Bounded in-memory log of user changes, for the change feed.
+//
+// UserService appends one entry per create, update and delete while holding
+// the user's shard lock, so the changes to any one user are logged in the
+// order they were applied. The log is split into one ring per store shard,
+// each with its own mutex, so writers to different shards never contend
+// here; the only state they share is the atomic sequence counter. Every
+// entry gets the next sequence number, taken under its ring's mutex, and
+// read() merges the rings back into sequence order.
+//
+// The log keeps the newest `capacity` changes however they are spread over
+// the shards: each ring grows as its shard needs, up to capacity entries,
+// and drops only entries that are no longer among the newest capacity. A
+// reader whose cursor is older than an entry some ring already dropped is
+// told to resync: re-read the full list, then follow the log again. Rings
+// are trimmed by their own appends and, now and then, by appends to other
+// shards, so a ring that goes quiet after a burst gives its memory back.
+//
+// Sequence numbers start from the startup time in microseconds rather than
+// from 0, so a cursor handed out by an earlier run is always older than the
+// rings and also gets a resync instead of silently skipping changes.
+class ChangeLog {
+public:
+    enum class Type {
+        Create,
+        Update,
+        Delete
+    };
+
+    struct Change {
+        uint64_t seq = 0;
+        Type type = Type::Create;
+        User user;  // Only the id is set for deletes
+    };
+
+    ChangeLog(size_t capacity, size_t shards) : shardCount(std::max<size_t>(shards, 1)) {
+        uint64_t start = startSequence();
+        base = start;
+        last.store(start, std::memory_order_relaxed);
+        resize(capacity);
+    }
+
+    // Resize the rings, discarding every entry; call before serving requests.
+    // A capacity of 0 disables the log.
+    void setCapacity(size_t capacity) {
+        base = last.load(std::memory_order_relaxed);
+        resize(capacity);
+    }
+
+    bool enabled() const {
+        return capacity > 0;
+    }
+
+    // Log a change to a user of store shard `shard`; returns its sequence
+    // number, or 0 if the log is disabled
+    uint64_t append(size_t shard, Type type, const UserView& user) {
+        if (capacity == 0) {
+            return 0;
+        }
+
+        Ring& ring = rings[shard % shardCount];
+        uint64_t seq;
+        {
+            std::lock_guard<std::mutex> lock(ring.mutex);
+            // Taken under the ring's mutex: a reader that has seen the counter
+            // pass seq finds the entry once it gets the same mutex
+            seq = last.fetch_add(1, std::memory_order_seq_cst) + 1;
+            trim(ring, seq);
+            Change& change = ring.push(capacity);
+            change.seq = seq;
+            change.type = type;
+            change.user.id = user.id;
+            change.user.name.assign(user.name.data(), user.name.size());  // Reuses the slot's capacity
+            change.user.email.assign(user.email.data(), user.email.size());
+            change.user.age = user.age;
+            change.user.version = user.version;
+        }
+
+        if (seq % TRIM_INTERVAL == 0) {
+            trimOther(seq);
+        }
+        if (waiters.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            appended.notify_all();
+        }
+        return seq;
+    }
+
+    // Sequence number of the newest change; a reader that has seen
+    // everything up to here is up to date
+    uint64_t latest() const {
+        return last.load(std::memory_order_seq_cst);
+    }
+
+    // Copy up to limit changes after since, oldest first. False if the
+    // reader must resync: since is older than an entry that was already
+    // overwritten, or is not a sequence number of this run.
+    bool read(uint64_t since, size_t limit, std::vector<Change>& out) const {
+        uint64_t newest = last.load(std::memory_order_seq_cst);
+        if (capacity == 0 || since < base || since > newest) {
+            return false;
+        }
+        // Sequence numbers have no gaps, so the answer is since + 1 onwards
+        uint64_t until = std::min(newest, since + limit);
+        size_t first = out.size();
+        for (size_t s = 0; s < shardCount; ++s) {
+            const Ring& ring = rings[s];
+            std::lock_guard<std::mutex> lock(ring.mutex);
+            if (ring.dropped > since) {
+                out.resize(first);
+                return false;
+            }
+            // A ring's entries are in sequence order, so skip to the first one
+            // after since
+            for (size_t i = ring.firstAfter(since); i < ring.count; ++i) {
+                const Change& change = ring.at(i);
+                if (change.seq > until) {
+                    break;
+                }
+                out.push_back(change);
+            }
+        }
+        std::sort(out.begin() + static_cast<std::ptrdiff_t>(first), out.end(),
+                  [](const Change& a, const Change& b) { return a.seq < b.seq; });
+        return true;
+    }
+
+    // Block until there is a change after since, timeout passes or close()
+    // is called; true if there is one
+    bool wait(uint64_t since, std::chrono::milliseconds timeout) const {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        appended.wait_for(lock, timeout, [this, since] { return latest() > since || closed; });
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+        return latest() > since;
+    }
+
+    // Wake every waiter and stop future waits from blocking, e.g. at shutdown
+    void close() {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        closed = true;
+        appended.notify_all();
+    }
+
+    bool isClosed() const {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        return closed;
+    }
+
+private:
+    static constexpr size_t MIN_RING_SIZE = 64;
+    static constexpr uint64_t TRIM_INTERVAL = 64;  // Appends between trims of another ring
+
+    // Circular buffer of one shard's entries, oldest first
+    struct alignas(64) Ring {
+        mutable std::mutex mutex;
+        std::vector<Change> entries;
+        size_t head = 0;       // Index of the oldest entry
+        size_t count = 0;      // Entries held
+        uint64_t dropped = 0;  // Sequence number of the newest dropped entry
+
+        Change& at(size_t i) {
+            return entries[(head + i) % entries.size()];
+        }
+
+        const Change& at(size_t i) const {
+            return entries[(head + i) % entries.size()];
+        }
+
+        // Position of the first entry after since, or count
+        size_t firstAfter(uint64_t since) const {
+            size_t low = 0;
+            size_t high = count;
+            while (low < high) {
+                size_t mid = low + (high - low) / 2;
+                if (at(mid).seq <= since) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+
+        // Slot for a new newest entry, doubling the buffer (up to limit
+        // entries) if it is full
+        Change& push(size_t limit) {
+            if (count == entries.size()) {
+                reallocate(std::max(count + 1, std::min(std::max(MIN_RING_SIZE, count * 2), limit)));
+            }
+            ++count;
+            return at(count - 1);
+        }
+
+        // Drop entries up to and including seq horizon; halve the buffer
+        // once it is at most a quarter full
+        void dropThrough(uint64_t horizon) {
+            while (count > 0 && at(0).seq <= horizon) {
+                dropped = at(0).seq;
+                head = (head + 1) % entries.size();
+                --count;
+            }
+            if (entries.size() > MIN_RING_SIZE && count * 4 <= entries.size()) {
+                reallocate(std::max(MIN_RING_SIZE, entries.size() / 2));
+            }
+        }
+
+        void reallocate(size_t size) {
+            std::vector<Change> moved(size);
+            for (size_t i = 0; i < count; ++i) {
+                moved[i] = std::move(at(i));
+            }
+            entries.swap(moved);
+            head = 0;
+        }
+    };
+
+    size_t shardCount;
+    size_t capacity = 0;  // Changes kept across all rings; 0 when disabled
+    std::unique_ptr<Ring[]> rings;
+    uint64_t base;                    // Sequence number before the first entry
+    std::atomic<uint64_t> last;       // Sequence number of the newest entry
+    std::atomic<size_t> nextTrim{0};  // Ring trimmed by the next trimOther()
+
+    mutable std::mutex waitMutex;
+    mutable std::condition_variable appended;
+    mutable std::atomic<size_t> waiters{0};
+    bool closed = false;
+
+    void resize(size_t newCapacity) {
+        capacity = newCapacity;
+        rings.reset(new Ring[shardCount]);
+    }
+
+    // Drop the entries of ring that are older than the newest capacity as
+    // of seq; call with the ring's mutex held
+    void trim(Ring& ring, uint64_t seq) {
+        if (seq > capacity) {
+            ring.dropThrough(seq - capacity);
+        }
+    }
+
+    // Trim the rings in turn, skipping one that is busy: a shard that stops
+    // being written would otherwise hold its old entries forever
+    void trimOther(uint64_t seq) {
+        Ring& ring = rings[nextTrim.fetch_add(1, std::memory_order_relaxed) % shardCount];
+        std::unique_lock<std::mutex> lock(ring.mutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            trim(ring, seq);
+        }
+    }
+
+    static uint64_t startSequence() {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+    }
+};
+
+#endif // CHANGE_LOG_HPP
@@ -0,0 +1,219 @@
+#ifndef EMAIL_INDEX_HPP
+#define EMAIL_INDEX_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Normalized email -> user id, shared by all UserService shards.
+//
+// Emails are unique across the whole store while users are sharded by id, so
+// this index cannot live in the shards. It is split into stripes by hash,
+// each behind its own mutex. Writers reserve and release entries while
+// holding the user's shard write lock and never take a shard lock while
+// holding a stripe, so the lock order is always shard -> stripe and a
+// check-and-reserve is atomic.
+//
+// A create claims its email before it has an id (see claim()), so that a
+// conflict does not use one up; the entry is PENDING until assign().
+//
+// Each stripe is an open-addressing table (linear probing, backward-shift
+// deletion, as in UserStore) of 12-byte entries that point into the
+// stripe's own key arena, so an email costs no heap allocation of its own.
+// Released keys leave garbage in the arena, which is packed once it is more
+// than half the arena.
+class EmailIndex {
+public:
+    static constexpr int PENDING = -1;
+
+    explicit EmailIndex(size_t stripes)
+        : stripeCount(stripes), stripes(new Stripe[stripes]) {}
+
+    // Map key to id unless another id holds it; false on a conflict
+    bool reserve(std::string_view key, int id) {
+        uint64_t hash = hashKey(key);
+        Stripe& stripe = stripeFor(hash);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        size_t i = stripe.find(key, hash);
+        if (i != stripe.entries.size()) {
+            return stripe.entries[i].id == id;
+        }
+        stripe.insert(key, hash, id);
+        return true;
+    }
+
+    // Map key to PENDING unless anyone holds it, a pending create included;
+    // false on a conflict. Needs no shard lock: no user has the key yet.
+    bool claim(std::string_view key) {
+        uint64_t hash = hashKey(key);
+        Stripe& stripe = stripeFor(hash);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        if (stripe.find(key, hash) != stripe.entries.size()) {
+            return false;
+        }
+        stripe.insert(key, hash, PENDING);
+        return true;
+    }
+
+    // Hand a claimed key to the new user id; call with id's shard write
+    // lock held
+    void assign(std::string_view key, int id) {
+        uint64_t hash = hashKey(key);
+        Stripe& stripe = stripeFor(hash);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        size_t i = stripe.find(key, hash);
+        if (i != stripe.entries.size()) {
+            stripe.entries[i].id = id;
+        }
+    }
+
+    // Remove key if it is held by id
+    void release(std::string_view key, int id) {
+        uint64_t hash = hashKey(key);
+        Stripe& stripe = stripeFor(hash);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        size_t i = stripe.find(key, hash);
+        if (i != stripe.entries.size() && stripe.entries[i].id == id) {
+            stripe.erase(i);
+        }
+    }
+
+    // Id holding key, or 0 (also while a create of it is pending)
+    int find(std::string_view key) const {
+        uint64_t hash = hashKey(key);
+        const Stripe& stripe = stripeFor(hash);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        size_t i = stripe.find(key, hash);
+        return i == stripe.entries.size() || stripe.entries[i].id == PENDING ? 0 : stripe.entries[i].id;
+    }
+
+private:
+    struct Entry {
+        uint32_t offset;  // Key text in the stripe's arena
+        int id;           // 0 = empty
+        uint16_t length;
+        uint16_t tag;     // Hash bits above the probe position, to skip most key compares
+    };
+
+    struct alignas(64) Stripe {
+        static constexpr size_t INITIAL_ENTRIES = 16;
+        static constexpr size_t MIN_COMPACT_BYTES = 4096;
+
+        mutable std::mutex mutex;
+        std::vector<Entry> entries = std::vector<Entry>(INITIAL_ENTRIES, Entry{0, 0, 0, 0});  // Power-of-two sized
+        std::vector<char> arena;
+        size_t count = 0;
+        size_t garbage = 0;  // Arena bytes no entry points to
+
+        size_t mask() const {
+            return entries.size() - 1;
+        }
+
+        static uint16_t tagOf(uint64_t hash) {
+            return static_cast<uint16_t>(hash >> 48);
+        }
+
+        std::string_view keyOf(const Entry& entry) const {
+            return std::string_view(arena.data() + entry.offset, entry.length);
+        }
+
+        // Index of the entry for key, or entries.size() if absent
+        size_t find(std::string_view key, uint64_t hash) const {
+            uint16_t tag = tagOf(hash);
+            for (size_t i = probeStart(hash); entries[i].id != 0; i = (i + 1) & mask()) {
+                if (entries[i].tag == tag && keyOf(entries[i]) == key) {
+                    return i;
+                }
+            }
+            return entries.size();
+        }
+
+        size_t probeStart(uint64_t hash) const {
+            // The low bits pick the stripe, so probe from the bits above them
+            return static_cast<size_t>(hash >> 16) & mask();
+        }
+
+        void place(const Entry& entry, uint64_t hash) {
+            size_t i = probeStart(hash);
+            while (entries[i].id != 0) {
+                i = (i + 1) & mask();
+            }
+            entries[i] = entry;
+        }
+
+        void insert(std::string_view key, uint64_t hash, int id) {
+            if (key.size() > UINT16_MAX) {
+                throw std::length_error("Email too long for the index");
+            }
+            if (arena.size() + key.size() > UINT32_MAX) {
+                compact();
+                if (arena.size() + key.size() > UINT32_MAX) {
+                    throw std::length_error("Email index arena is full");
+                }
+            }
+            // Keep the load factor at or below 1/2, as in UserStore
+            if ((count + 1) * 2 > entries.size()) {
+                std::vector<Entry> old(entries.size() * 2, Entry{0, 0, 0, 0});
+                old.swap(entries);
+                for (const Entry& entry : old) {
+                    if (entry.id != 0) {
+                        place(entry, hashKey(keyOf(entry)));
+                    }
+                }
+            }
+            Entry entry{static_cast<uint32_t>(arena.size()), id, static_cast<uint16_t>(key.size()), tagOf(hash)};
+            arena.insert(arena.end(), key.begin(), key.end());
+            place(entry, hash);
+            ++count;
+        }
+
+        // Backward-shift deletion keeps probe chains intact without tombstones
+        void erase(size_t hole) {
+            garbage += entries[hole].length;
+            for (size_t i = (hole + 1) & mask(); entries[i].id != 0; i = (i + 1) & mask()) {
+                size_t home = probeStart(hashKey(keyOf(entries[i])));
+                if (((i - home) & mask()) >= ((i - hole) & mask())) {
+                    entries[hole] = entries[i];
+                    hole = i;
+                }
+            }
+            entries[hole] = Entry{0, 0, 0, 0};
+            --count;
+            if (garbage >= MIN_COMPACT_BYTES && garbage * 2 > arena.size()) {
+                compact();
+            }
+        }
+
+        // Copy the live keys into a right-sized arena
+        void compact() {
+            std::vector<char> packed;
+            packed.reserve(arena.size() - garbage);
+            for (Entry& entry : entries) {
+                if (entry.id != 0) {
+                    std::string_view key = keyOf(entry);
+                    entry.offset = static_cast<uint32_t>(packed.size());
+                    packed.insert(packed.end(), key.begin(), key.end());
+                }
+            }
+            arena.swap(packed);
+            garbage = 0;
+        }
+    };
+
+    size_t stripeCount;
+    std::unique_ptr<Stripe[]> stripes;
+
+    static uint64_t hashKey(std::string_view key) {
+        return std::hash<std::string_view>{}(key);
+    }
+
+    Stripe& stripeFor(uint64_t hash) const {
+        return stripes[hash % stripeCount];
+    }
+};
+
+#endif // EMAIL_INDEX_HPP
@@ -0,0 +1,702 @@
+#ifndef SHARED_USER_STORE_HPP
+#define SHARED_USER_STORE_HPP
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <new>
+#include "../models/User.hpp"
+#include "../models/BulkOperation.hpp"
+#include "UserColumns.hpp"
+#include "../utils/Metrics.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <pthread.h>
+#endif
+
+// User storage in an anonymous shared memory mapping, for --workers mode.
+//
+// The mapping is created by the parent before the workers are forked, so
+// every worker process reads and writes the same users. Like UserService it
+// is split into a power-of-two number of shards keyed by id. Each shard has a
+// process-shared pthread rwlock, an open-addressing id -> record index
+// (linear probing, backward-shift deletion, as in UserStore) and a fixed
+// array of fixed-width records with a free list. Nothing in the region is a
+// pointer and nothing is allocated after construction, so capacity is fixed
+// and names and emails are limited to MAX_FIELD_LENGTH bytes.
+//
+// Email uniqueness uses a second table striped by email hash, each stripe
+// behind a process-shared mutex that is only taken while holding a shard
+// write lock. Entries store the 64-bit hash of the normalized email rather
+// than the email itself: lookups confirm the match against the record, but
+// a create whose email collides with another one's hash is rejected as a
+// duplicate (about one in 10^7 at a million users).
+//
+// A worker that dies while holding a shard lock leaves it locked; the parent
+// treats any worker exit as fatal for the whole group.
+class SharedUserStore {
+public:
+    static constexpr size_t MAX_FIELD_LENGTH = 255;
+
+    struct ShardStats {
+        size_t users;
+        uint64_t contended;  // Lock acquisitions that had to wait
+    };
+
+private:
+    struct Record {
+        int32_t id;  // 0 = free
+        int32_t age;
+        uint64_t version;  // Store version of the last change
+        uint16_t nameLength;
+        uint16_t emailLength;
+        char name[MAX_FIELD_LENGTH + 1];
+        char email[MAX_FIELD_LENGTH + 1];
+    };
+
+    struct Bucket {
+        int32_t id;
+        uint32_t slot;
+    };
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    static constexpr int32_t PENDING_ID = -1;  // Email claimed by a create not yet given an id
+
+    struct EmailEntry {
+        uint64_t hash;
+        int32_t id;  // 0 = empty
+        uint32_t unused;
+    };
+
+    struct alignas(64) EmailStripe {
+#ifndef _WIN32
+        pthread_mutex_t lock;
+#endif
+        uint32_t count;
+    };
+
+    enum class Reservation {
+        Reserved,  // The email now maps to the user (or already did)
+        Taken,     // Another user has it
+        Full       // No room left
+    };
+
+    struct alignas(64) Header {
+        std::atomic<int> nextId;
+        std::atomic<uint64_t> version;  // Bumped under a shard write lock by every change
+    };
+
+    struct alignas(64) ShardHeader {
+#ifndef _WIN32
+        pthread_rwlock_t lock;
+#endif
+        uint32_t count;
+        uint32_t used;       // Records ever handed out (high-water mark)
+        uint32_t freeCount;  // Entries on the free list
+        std::atomic<uint64_t> contended;
+    };
+
+    char* region = nullptr;
+    size_t regionSize = 0;
+    size_t shardCount;
+    size_t capacity;     // Records per shard
+    size_t bucketCount;  // Index buckets per shard, a power of two
+    size_t shardStride;  // Bytes of index, free list and records per shard
+    size_t emailOffset;  // Start of the email stripes; each has bucketCount entries
+
+    Header* header() const {
+        return reinterpret_cast<Header*>(region);
+    }
+
+    ShardHeader& shardHeader(size_t s) const {
+        return reinterpret_cast<ShardHeader*>(region + sizeof(Header))[s];
+    }
+
+    char* shardBase(size_t s) const {
+        return region + sizeof(Header) + shardCount * sizeof(ShardHeader) + s * shardStride;
+    }
+
+    Bucket* buckets(size_t s) const {
+        return reinterpret_cast<Bucket*>(shardBase(s));
+    }
+
+    uint32_t* freeList(size_t s) const {
+        return reinterpret_cast<uint32_t*>(shardBase(s) + bucketCount * sizeof(Bucket));
+    }
+
+    Record* records(size_t s) const {
+        return reinterpret_cast<Record*>(shardBase(s) + align(bucketCount * sizeof(Bucket) + capacity * sizeof(uint32_t)));
+    }
+
+    EmailStripe& emailStripe(size_t e) const {
+        return reinterpret_cast<EmailStripe*>(region + emailOffset)[e];
+    }
+
+    EmailEntry* emailTable(size_t e) const {
+        return reinterpret_cast<EmailEntry*>(region + emailOffset + align(shardCount * sizeof(EmailStripe))) +
+               e * bucketCount;
+    }
+
+    static size_t align(size_t bytes) {
+        return (bytes + 63) & ~size_t(63);
+    }
+
+    static size_t roundUpPowerOfTwo(size_t n) {
+        size_t result = 1;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    size_t shardOf(int id) const {
+        return static_cast<uint32_t>(id) & (shardCount - 1);
+    }
+
+    static size_t hashId(int id) {
+        return static_cast<size_t>(static_cast<uint64_t>(static_cast<uint32_t>(id)) * 0x9E3779B97F4A7C15ULL >> 32);
+    }
+
+    static uint64_t hashEmail(const std::string& email) {
+        return std::hash<std::string>{}(User::normalizeEmail(email));
+    }
+
+    // Stripe from the high bits, probe position from the low bits
+    size_t stripeOf(uint64_t hash) const {
+        return static_cast<size_t>(hash >> 40) & (shardCount - 1);
+    }
+
+#ifndef _WIN32
+    // Holds a shard lock; acquisitions that have to wait are counted and
+    // timed like UserService's
+    class Guard {
+    private:
+        pthread_rwlock_t* lock;
+
+    public:
+        Guard(ShardHeader& shard, bool write) : lock(&shard.lock) {
+            int busy = write ? pthread_rwlock_trywrlock(lock) : pthread_rwlock_tryrdlock(lock);
+            if (busy == 0) {
+                return;
+            }
+            shard.contended.fetch_add(1, std::memory_order_relaxed);
+            uint64_t start = Metrics::now();
+            if (write) {
+                pthread_rwlock_wrlock(lock);
+            } else {
+                pthread_rwlock_rdlock(lock);
+            }
+            Metrics::recordLockWait(write ? Metrics::LockMode::Write : Metrics::LockMode::Read, Metrics::now() - start);
+        }
+        ~Guard() { pthread_rwlock_unlock(lock); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    class StripeGuard {
+    private:
+        pthread_mutex_t* lock;
+
+    public:
+        explicit StripeGuard(EmailStripe& stripe) : lock(&stripe.lock) { pthread_mutex_lock(lock); }
+        ~StripeGuard() { pthread_mutex_unlock(lock); }
+
+        StripeGuard(const StripeGuard&) = delete;
+        StripeGuard& operator=(const StripeGuard&) = delete;
+    };
+#else
+    // Never constructed: the store cannot be created on Windows
+    struct Guard {
+        Guard(ShardHeader&, bool) {}
+    };
+
+    struct StripeGuard {
+        explicit StripeGuard(EmailStripe&) {}
+    };
+#endif
+
+    // Record index of id in shard s, or EMPTY
+    uint32_t lookup(size_t s, int id) const {
+        const Bucket* table = buckets(s);
+        size_t mask = bucketCount - 1;
+        for (size_t i = hashId(id) & mask; table[i].slot != EMPTY; i = (i + 1) & mask) {
+            if (table[i].id == id) {
+                return table[i].slot;
+            }
+        }
+        return EMPTY;
+    }
+
+    void index(size_t s, int id, uint32_t slot) {
+        Bucket* table = buckets(s);
+        size_t mask = bucketCount - 1;
+        size_t i = hashId(id) & mask;
+        while (table[i].slot != EMPTY) {
+            i = (i + 1) & mask;
+        }
+        table[i] = Bucket{id, slot};
+    }
+
+    void unindex(size_t s, int id) {
+        Bucket* table = buckets(s);
+        size_t mask = bucketCount - 1;
+        size_t hole = hashId(id) & mask;
+        while (table[hole].id != id) {
+            hole = (hole + 1) & mask;
+        }
+
+        for (size_t i = (hole + 1) & mask; table[i].slot != EMPTY; i = (i + 1) & mask) {
+            size_t home = hashId(table[i].id) & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                table[hole] = table[i];
+                hole = i;
+            }
+        }
+        table[hole] = Bucket{0, EMPTY};
+    }
+
+    // Map hash to id; call with id's shard write lock held. With id
+    // PENDING_ID (and no lock), claims the email for a create that has no id
+    // yet: any existing entry, a pending one included, is then a conflict.
+    Reservation reserveEmail(uint64_t hash, int id) {
+        size_t e = stripeOf(hash);
+        EmailStripe& stripe = emailStripe(e);
+        StripeGuard guard(stripe);
+        EmailEntry* table = emailTable(e);
+        size_t mask = bucketCount - 1;
+        size_t i = hash & mask;
+        for (; table[i].id != 0; i = (i + 1) & mask) {
+            if (table[i].hash == hash) {
+                return table[i].id == id && id != PENDING_ID ? Reservation::Reserved : Reservation::Taken;
+            }
+        }
+        // Same load factor limit as the id index
+        if ((stripe.count + 1) * 2 > bucketCount) {
+            return Reservation::Full;
+        }
+        table[i] = EmailEntry{hash, id, 0};
+        ++stripe.count;
+        return Reservation::Reserved;
+    }
+
+    // Hand an email claimed with PENDING_ID to id; call with id's shard
+    // write lock held
+    void assignEmail(uint64_t hash, int id) {
+        size_t e = stripeOf(hash);
+        StripeGuard guard(emailStripe(e));
+        EmailEntry* table = emailTable(e);
+        size_t mask = bucketCount - 1;
+        for (size_t i = hash & mask; table[i].id != 0; i = (i + 1) & mask) {
+            if (table[i].hash == hash && table[i].id == PENDING_ID) {
+                table[i].id = id;
+                return;
+            }
+        }
+    }
+
+    // Remove hash if it maps to id; call with id's shard write lock held
+    void releaseEmail(uint64_t hash, int id) {
+        size_t e = stripeOf(hash);
+        EmailStripe& stripe = emailStripe(e);
+        StripeGuard guard(stripe);
+        EmailEntry* table = emailTable(e);
+        size_t mask = bucketCount - 1;
+        size_t hole = hash & mask;
+        while (table[hole].id != 0 && !(table[hole].hash == hash && table[hole].id == id)) {
+            hole = (hole + 1) & mask;
+        }
+        if (table[hole].id == 0) {
+            return;
+        }
+
+        // Backward-shift deletion, as in unindex()
+        for (size_t i = (hole + 1) & mask; table[i].id != 0; i = (i + 1) & mask) {
+            size_t home = table[i].hash & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                table[hole] = table[i];
+                hole = i;
+            }
+        }
+        table[hole] = EmailEntry{0, 0, 0};
+        --stripe.count;
+    }
+
+    int findEmail(uint64_t hash) const {
+        size_t e = stripeOf(hash);
+        StripeGuard guard(emailStripe(e));
+        const EmailEntry* table = emailTable(e);
+        size_t mask = bucketCount - 1;
+        for (size_t i = hash & mask; table[i].id != 0; i = (i + 1) & mask) {
+            if (table[i].hash == hash) {
+                return table[i].id == PENDING_ID ? 0 : table[i].id;
+            }
+        }
+        return 0;
+    }
+
+    static uint64_t hashEmail(const Record& record) {
+        return hashEmail(std::string(record.email, record.emailLength));
+    }
+
+    static void checkFits(const User& user) {
+        if (!fits(user)) {
+            throw std::length_error("User fields exceed the shared store limit");
+        }
+    }
+
+    static void store(Record& record, const User& user) {
+        record.age = user.age;
+        record.nameLength = static_cast<uint16_t>(user.name.size());
+        record.emailLength = static_cast<uint16_t>(user.email.size());
+        std::memcpy(record.name, user.name.data(), user.name.size());
+        std::memcpy(record.email, user.email.data(), user.email.size());
+    }
+
+    static User load(const Record& record) {
+        User user(record.id, std::string(record.name, record.nameLength),
+                  std::string(record.email, record.emailLength), record.age);
+        user.version = record.version;
+        return user;
+    }
+
+    // Call with the shard write lock held; nullptr if the email is taken or
+    // there is no room, as reported in email
+    Record* insertLocked(size_t s, const User& user, Reservation& email) {
+        ShardHeader& shard = shardHeader(s);
+        if (shard.freeCount == 0 && shard.used == capacity) {
+            email = Reservation::Full;
+            return nullptr;
+        }
+        email = reserveEmail(hashEmail(user.email), user.id);
+        if (email != Reservation::Reserved) {
+            return nullptr;
+        }
+
+        uint32_t slot = shard.freeCount > 0 ? freeList(s)[--shard.freeCount] : shard.used++;
+        Record& record = records(s)[slot];
+        store(record, user);
+        record.id = user.id;
+        index(s, user.id, slot);
+        ++shard.count;
+        return &record;
+    }
+
+    // nullptr if id is absent, or if the new email is not Reserved
+    Record* updateLocked(size_t s, int id, const User& user, Reservation& email) {
+        email = Reservation::Reserved;
+        uint32_t slot = lookup(s, id);
+        if (slot == EMPTY) {
+            return nullptr;
+        }
+
+        Record& record = records(s)[slot];
+        uint64_t oldHash = hashEmail(record);
+        uint64_t newHash = hashEmail(user.email);
+        if (newHash != oldHash) {
+            email = reserveEmail(newHash, id);
+            if (email != Reservation::Reserved) {
+                return nullptr;
+            }
+            releaseEmail(oldHash, id);
+        }
+        store(record, user);
+        return &record;
+    }
+
+    bool eraseLocked(size_t s, int id) {
+        uint32_t slot = lookup(s, id);
+        if (slot == EMPTY) {
+            return false;
+        }
+        releaseEmail(hashEmail(records(s)[slot]), id);
+        unindex(s, id);
+        records(s)[slot].id = 0;
+        ShardHeader& shard = shardHeader(s);
+        freeList(s)[shard.freeCount++] = slot;
+        --shard.count;
+        return true;
+    }
+
+    static int statusFor(Reservation email) {
+        return email == Reservation::Taken ? 409 : 507;
+    }
+
+    // Returns the new store version
+    uint64_t markChanged() {
+        return header()->version.fetch_add(1, std::memory_order_release) + 1;
+    }
+
+public:
+    // Map a region for about totalCapacity users over shards shards. Shards
+    // get 25% headroom since ids are not spread perfectly evenly.
+    SharedUserStore(size_t totalCapacity, size_t shards)
+        : shardCount(roundUpPowerOfTwo(std::max<size_t>(shards, 1))) {
+#ifdef _WIN32
+        (void)totalCapacity;
+        throw std::runtime_error("Shared user store requires POSIX shared memory");
+#else
+        capacity = std::max<size_t>(totalCapacity / shardCount * 5 / 4, 16);
+        if (capacity >= EMPTY) {
+            throw std::invalid_argument("Shared store capacity too large");
+        }
+        bucketCount = roundUpPowerOfTwo(capacity * 2);
+        shardStride = align(align(bucketCount * sizeof(Bucket) + capacity * sizeof(uint32_t)) + capacity * sizeof(Record));
+        emailOffset = sizeof(Header) + shardCount * sizeof(ShardHeader) + shardCount * shardStride;
+        regionSize = emailOffset + align(shardCount * sizeof(EmailStripe)) + shardCount * bucketCount * sizeof(EmailEntry);
+
+        // Pages are only committed when first touched
+        void* mapped = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error(std::string("Cannot map shared user store: ") + std::strerror(errno));
+        }
+        region = static_cast<char*>(mapped);
+
+        new (header()) Header();
+        header()->nextId.store(1);
+        header()->version.store(0);
+
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef __GLIBC__
+        // Readers must not starve writers across many worker processes
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+        for (size_t s = 0; s < shardCount; ++s) {
+            ShardHeader* shard = new (&shardHeader(s)) ShardHeader();
+            pthread_rwlock_init(&shard->lock, &attr);
+            shard->count = 0;
+            shard->used = 0;
+            shard->freeCount = 0;
+            shard->contended.store(0);
+
+            Bucket* table = buckets(s);
+            for (size_t i = 0; i < bucketCount; ++i) {
+                table[i] = Bucket{0, EMPTY};
+            }
+        }
+        pthread_rwlockattr_destroy(&attr);
+
+        // Email tables start zeroed (id 0 = empty), like any fresh mapping
+        pthread_mutexattr_t mutexAttr;
+        pthread_mutexattr_init(&mutexAttr);
+        pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+        for (size_t e = 0; e < shardCount; ++e) {
+            EmailStripe* stripe = new (&emailStripe(e)) EmailStripe();
+            pthread_mutex_init(&stripe->lock, &mutexAttr);
+            stripe->count = 0;
+        }
+        pthread_mutexattr_destroy(&mutexAttr);
+#endif
+    }
+
+    ~SharedUserStore() {
+#ifndef _WIN32
+        // Every process unmaps its own view; the memory goes away with the last
+        if (region) {
+            munmap(region, regionSize);
+        }
+#endif
+    }
+
+    SharedUserStore(const SharedUserStore&) = delete;
+    SharedUserStore& operator=(const SharedUserStore&) = delete;
+
+    size_t totalCapacity() const {
+        return capacity * shardCount;
+    }
+
+    uint64_t version() const {
+        return header()->version.load(std::memory_order_acquire);
+    }
+
+    // True if the user's strings fit in a record
+    static bool fits(const User& user) {
+        return user.name.size() <= MAX_FIELD_LENGTH && user.email.size() <= MAX_FIELD_LENGTH;
+    }
+
+    // Conflict if the email is taken; Full if the user's shard or email
+    // stripe has no room left
+    WriteResult create(const User& user, User& created) {
+        checkFits(user);
+        // Claim the email before taking an id, so a conflict does not use
+        // one up
+        uint64_t hash = hashEmail(user.email);
+        Reservation email = reserveEmail(hash, PENDING_ID);
+        if (email != Reservation::Reserved) {
+            return email == Reservation::Taken ? WriteResult::Conflict : WriteResult::Full;
+        }
+        User newUser = user;
+        newUser.id = header()->nextId.fetch_add(1, std::memory_order_relaxed);
+
+        size_t s = shardOf(newUser.id);
+        Guard guard(shardHeader(s), true);
+        assignEmail(hash, newUser.id);
+        Record* record = insertLocked(s, newUser, email);
+        if (!record) {
+            releaseEmail(hash, newUser.id);
+            return WriteResult::Full;
+        }
+        newUser.version = record->version = markChanged();
+        created = newUser;
+        return WriteResult::Ok;
+    }
+
+    bool find(int id, User& user) const {
+        size_t s = shardOf(id);
+        Guard guard(shardHeader(s), false);
+        uint32_t slot = lookup(s, id);
+        if (slot == EMPTY) {
+            return false;
+        }
+        user = load(records(s)[slot]);
+        return true;
+    }
+
+    // Version of the user's last change, without copying the user
+    bool findVersion(int id, uint64_t& version) const {
+        size_t s = shardOf(id);
+        Guard guard(shardHeader(s), false);
+        uint32_t slot = lookup(s, id);
+        if (slot == EMPTY) {
+            return false;
+        }
+        version = records(s)[slot].version;
+        return true;
+    }
+
+    // User with this email (compared normalized); false if none
+    bool findByEmail(const std::string& email, User& user) const {
+        std::string key = User::normalizeEmail(email);
+        int id = findEmail(std::hash<std::string>{}(key));
+        return id != 0 && find(id, user) && User::normalizeEmail(user.email) == key;
+    }
+
+    // Full if the new email's stripe has no room left
+    WriteResult update(int id, const User& user) {
+        checkFits(user);
+        size_t s = shardOf(id);
+        Guard guard(shardHeader(s), true);
+        Reservation email;
+        Record* record = updateLocked(s, id, user, email);
+        if (email == Reservation::Taken) {
+            return WriteResult::Conflict;
+        }
+        if (email == Reservation::Full) {
+            return WriteResult::Full;
+        }
+        if (!record) {
+            return WriteResult::NotFound;
+        }
+        record->version = markChanged();
+        return WriteResult::Ok;
+    }
+
+    bool erase(int id) {
+        size_t s = shardOf(id);
+        Guard guard(shardHeader(s), true);
+        if (!eraseLocked(s, id)) {
+            return false;
+        }
+        markChanged();
+        return true;
+    }
+
+    // Same grouping and ordering as UserService::applyBulk. Creates that do
+    // not fit in their shard get status 507, and creates and updates to a
+    // taken email 409.
+    std::vector<BulkResult> applyBulk(const std::vector<BulkOperation>& ops) {
+        for (const auto& op : ops) {
+            if (op.type != BulkOperation::Type::Delete) {
+                checkFits(op.user);
+            }
+        }
+
+        std::vector<BulkResult> results(ops.size(), BulkResult{0, 404});
+
+        size_t creates = std::count_if(ops.begin(), ops.end(),
+            [](const BulkOperation& op) { return op.type == BulkOperation::Type::Create; });
+        int id = header()->nextId.fetch_add(static_cast<int>(creates), std::memory_order_relaxed);
+
+        std::vector<std::vector<size_t>> byShard(shardCount);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            results[i].id = ops[i].type == BulkOperation::Type::Create ? id++ : ops[i].user.id;
+            byShard[shardOf(results[i].id)].push_back(i);
+        }
+
+        for (size_t s = 0; s < shardCount; ++s) {
+            if (byShard[s].empty()) {
+                continue;
+            }
+
+            Guard guard(shardHeader(s), true);
+            uint64_t changed = markChanged();
+            for (size_t i : byShard[s]) {
+                const BulkOperation& op = ops[i];
+                BulkResult& result = results[i];
+
+                if (op.type == BulkOperation::Type::Create) {
+                    User newUser = op.user;
+                    newUser.id = result.id;
+                    Reservation email;
+                    Record* record = insertLocked(s, newUser, email);
+                    if (record) {
+                        record->version = changed;
+                    }
+                    result.status = record ? 201 : statusFor(email);
+                } else if (op.type == BulkOperation::Type::Update) {
+                    Reservation email;
+                    if (Record* record = updateLocked(s, result.id, op.user, email)) {
+                        record->version = changed;
+                        result.status = 200;
+                    } else if (email != Reservation::Reserved) {
+                        result.status = statusFor(email);
+                    }
+                } else if (eraseLocked(s, result.id)) {
+                    result.status = 200;
+                }
+            }
+        }
+        return results;
+    }
+
+    // Append every user to users, in no particular order
+    void collect(UserColumns& users) const {
+        for (size_t s = 0; s < shardCount; ++s) {
+            Guard guard(shardHeader(s), false);
+            const Record* table = records(s);
+            for (uint32_t slot = 0; slot < shardHeader(s).used; ++slot) {
+                const Record& record = table[slot];
+                if (record.id != 0) {
+                    users.push_back(UserView{record.id, std::string_view(record.name, record.nameLength),
+                                             std::string_view(record.email, record.emailLength), record.age,
+                                             record.version});
+                }
+            }
+        }
+    }
+
+    std::vector<ShardStats> getShardStats() const {
+        std::vector<ShardStats> stats;
+        stats.reserve(shardCount);
+        for (size_t s = 0; s < shardCount; ++s) {
+            Guard guard(shardHeader(s), false);
+            stats.push_back(ShardStats{
+                shardHeader(s).count,
+                shardHeader(s).contended.load(std::memory_order_relaxed)
+            });
+        }
+        return stats;
+    }
+};
+
+#endif // SHARED_USER_STORE_HPP
@@ -0,0 +1,148 @@
+#ifndef SORTED_BLOCKS_HPP
+#define SORTED_BLOCKS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Ordered set of small keys (ids, (age, id) pairs) kept in sorted blocks.
+//
+// A std::set costs a 40-48 byte tree node per key; here the keys sit in
+// sorted arrays of up to BLOCK_BYTES each, so a key costs its own size plus
+// the block's free space. A lookup binary-searches the blocks, then the
+// block; an insert or erase moves at most one block's keys. Full blocks are
+// split in half, except that a key past the last block starts a new one,
+// so keys inserted in increasing order (new ids) fill blocks completely.
+// Neighbouring blocks that fit in 3/4 of a block are merged, so a block is
+// on average more than a third full however keys are erased.
+//
+// Not thread-safe: callers are responsible for locking.
+template <typename Key>
+class SortedBlocks {
+private:
+    using Block = std::vector<Key>;
+
+    static constexpr size_t BLOCK_BYTES = 2048;
+    static constexpr size_t BLOCK_SIZE = BLOCK_BYTES / sizeof(Key);
+
+    std::vector<Block> blocks;  // Each sorted, non-empty, and below every later block
+    size_t count = 0;
+
+    static Block newBlock() {
+        Block block;
+        block.reserve(BLOCK_SIZE);
+        return block;
+    }
+
+    // First block whose last key is not below key, else the last block;
+    // call only when not empty
+    size_t blockFor(const Key& key) const {
+        auto it = std::partition_point(blocks.begin(), blocks.end(),
+                                       [&key](const Block& block) { return block.back() < key; });
+        return it == blocks.end() ? blocks.size() - 1 : static_cast<size_t>(it - blocks.begin());
+    }
+
+    void split(size_t b) {
+        Block upper = newBlock();
+        upper.assign(blocks[b].begin() + BLOCK_SIZE / 2, blocks[b].end());
+        blocks[b].resize(BLOCK_SIZE / 2);
+        blocks.insert(blocks.begin() + static_cast<std::ptrdiff_t>(b) + 1, std::move(upper));
+    }
+
+    // Merge block b + 1 into block b if both fit in 3/4 of a block
+    void mergeNext(size_t b) {
+        if (b + 1 >= blocks.size() || blocks[b].size() + blocks[b + 1].size() > BLOCK_SIZE * 3 / 4) {
+            return;
+        }
+        blocks[b].insert(blocks[b].end(), blocks[b + 1].begin(), blocks[b + 1].end());
+        blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(b) + 1);
+    }
+
+public:
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // Largest key; call only when not empty
+    const Key& back() const {
+        return blocks.back().back();
+    }
+
+    // Insert a key that is not already present
+    void insert(const Key& key) {
+        ++count;
+        if (blocks.empty() || (blocks.back().size() == BLOCK_SIZE && blocks.back().back() < key)) {
+            blocks.push_back(newBlock());
+            blocks.back().push_back(key);
+            return;
+        }
+
+        size_t b = blockFor(key);
+        if (blocks[b].size() == BLOCK_SIZE) {
+            split(b);
+            if (blocks[b].back() < key) {
+                ++b;
+            }
+        }
+        Block& block = blocks[b];
+        block.insert(std::upper_bound(block.begin(), block.end(), key), key);
+    }
+
+    // False if key is absent
+    bool erase(const Key& key) {
+        if (blocks.empty()) {
+            return false;
+        }
+        size_t b = blockFor(key);
+        Block& block = blocks[b];
+        auto it = std::lower_bound(block.begin(), block.end(), key);
+        if (it == block.end() || key < *it) {
+            return false;
+        }
+        block.erase(it);
+        --count;
+
+        if (block.empty()) {
+            blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(b));
+        } else {
+            mergeNext(b);
+        }
+        if (b > 0) {
+            mergeNext(b - 1);
+        }
+        return true;
+    }
+
+    // Visit keys greater than after in ascending order until fn returns false
+    template <typename Fn>
+    void forEachAfter(const Key& after, Fn&& fn) const {
+        if (blocks.empty()) {
+            return;
+        }
+        size_t b = blockFor(after);
+        size_t i = static_cast<size_t>(std::upper_bound(blocks[b].begin(), blocks[b].end(), after) - blocks[b].begin());
+        for (; b < blocks.size(); ++b, i = 0) {
+            const Block& block = blocks[b];
+            for (; i < block.size(); ++i) {
+                if (!fn(block[i])) {
+                    return;
+                }
+            }
+        }
+    }
+
+    // Bytes allocated for the blocks and the block list
+    size_t memoryUsage() const {
+        size_t bytes = blocks.capacity() * sizeof(Block);
+        for (const Block& block : blocks) {
+            bytes += block.capacity() * sizeof(Key);
+        }
+        return bytes;
+    }
+};
+
+#endif // SORTED_BLOCKS_HPP
@@ -0,0 +1,181 @@
+#ifndef USER_COLUMNS_HPP
+#define USER_COLUMNS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include "../models/User.hpp"
+
+// Column-oriented user records.
+//
+// Ids, ages and versions live in fixed-width columns, and each record's name
+// and email sit back to back in one shared byte arena, addressed by a 32-bit
+// offset and two lengths. A record costs 28 bytes plus its text, against
+// sizeof(User) (88 bytes) plus a heap block per string too long for SSO,
+// and scans walk contiguous arrays instead of chasing string pointers.
+//
+// Overwriting or clearing a record leaves its old text behind as garbage;
+// once garbage is more than half the arena, the live text is packed into a
+// fresh one. Views from operator[] are invalidated by any change, and must
+// not be passed back into assign() or push_back() of the same table.
+//
+// Not thread-safe: callers are responsible for locking.
+class UserColumns {
+private:
+    struct Text {
+        uint32_t offset;
+        uint32_t nameLength;
+        uint32_t emailLength;
+    };
+
+    static constexpr size_t MIN_COMPACT_BYTES = 4096;
+
+    std::vector<int> ids;
+    std::vector<int> ages;
+    std::vector<uint64_t> versions;
+    std::vector<Text> texts;
+    std::vector<char> arena;
+    size_t garbage = 0;  // Arena bytes no record points to
+
+    Text appendText(const UserView& user) {
+        size_t length = user.name.size() + user.email.size();
+        if (arena.size() + length > UINT32_MAX) {
+            compact();
+            if (arena.size() + length > UINT32_MAX) {
+                throw std::length_error("User text arena is full");
+            }
+        }
+        Text text{static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(user.name.size()),
+                  static_cast<uint32_t>(user.email.size())};
+        arena.insert(arena.end(), user.name.begin(), user.name.end());
+        arena.insert(arena.end(), user.email.begin(), user.email.end());
+        return text;
+    }
+
+    void release(const Text& text) {
+        garbage += text.nameLength + text.emailLength;
+        if (garbage >= MIN_COMPACT_BYTES && garbage * 2 > arena.size()) {
+            compact();
+        }
+    }
+
+    // Copy the live text into a right-sized arena, in record order
+    void compact() {
+        std::vector<char> packed;
+        packed.reserve(arena.size() - garbage);
+        for (Text& text : texts) {
+            auto first = arena.begin() + text.offset;
+            text.offset = static_cast<uint32_t>(packed.size());
+            packed.insert(packed.end(), first, first + text.nameLength + text.emailLength);
+        }
+        arena.swap(packed);
+        garbage = 0;
+    }
+
+    // Reorder every fixed-width column by order; the arena stays as it is
+    void permute(const std::vector<uint32_t>& order) {
+        auto apply = [&order](auto& column) {
+            typename std::decay<decltype(column)>::type sorted;
+            sorted.reserve(column.size());
+            for (uint32_t i : order) {
+                sorted.push_back(column[i]);
+            }
+            column.swap(sorted);
+        };
+        apply(ids);
+        apply(ages);
+        apply(versions);
+        apply(texts);
+    }
+
+public:
+    size_t size() const {
+        return ids.size();
+    }
+
+    bool empty() const {
+        return ids.empty();
+    }
+
+    UserView operator[](size_t i) const {
+        const Text& text = texts[i];
+        const char* base = arena.data() + text.offset;
+        return UserView{ids[i], std::string_view(base, text.nameLength),
+                        std::string_view(base + text.nameLength, text.emailLength), ages[i], versions[i]};
+    }
+
+    int id(size_t i) const {
+        return ids[i];
+    }
+
+    int age(size_t i) const {
+        return ages[i];
+    }
+
+    // Id column, e.g. for binary searches over id-sorted tables
+    const std::vector<int>& idColumn() const {
+        return ids;
+    }
+
+    void reserve(size_t records, size_t textBytes) {
+        ids.reserve(records);
+        ages.reserve(records);
+        versions.reserve(records);
+        texts.reserve(records);
+        arena.reserve(textBytes);
+    }
+
+    void push_back(const UserView& user) {
+        texts.push_back(appendText(user));
+        ids.push_back(user.id);
+        ages.push_back(user.age);
+        versions.push_back(user.version);
+    }
+
+    // Overwrite record i with user's fields, id and version included
+    void assign(size_t i, const UserView& user) {
+        Text old = texts[i];
+        texts[i] = appendText(user);
+        ids[i] = user.id;
+        ages[i] = user.age;
+        versions[i] = user.version;
+        release(old);
+    }
+
+    void setVersion(size_t i, uint64_t version) {
+        versions[i] = version;
+    }
+
+    // Empty record i and mark it free (id 0); its slot stays in the table
+    void clear(size_t i) {
+        Text old = texts[i];
+        texts[i] = Text{0, 0, 0};
+        ids[i] = 0;
+        ages[i] = 0;
+        versions[i] = 0;
+        release(old);
+    }
+
+    // Order records by id, e.g. after appending several id-ordered runs
+    void sortById() {
+        if (std::is_sorted(ids.begin(), ids.end())) {
+            return;
+        }
+        std::vector<uint32_t> order(ids.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return ids[a] < ids[b]; });
+        permute(order);
+    }
+
+    // Bytes allocated for columns and arena
+    size_t memoryUsage() const {
+        return ids.capacity() * sizeof(int) + ages.capacity() * sizeof(int) +
+               versions.capacity() * sizeof(uint64_t) + texts.capacity() * sizeof(Text) + arena.capacity();
+    }
+};
+
+#endif // USER_COLUMNS_HPP
@@ -0,0 +1,620 @@
+#ifndef USER_PERSISTENCE_HPP
+#define USER_PERSISTENCE_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include "../models/User.hpp"
+#include "UserColumns.hpp"
+#include "../utils/Logger.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Write-ahead log and snapshot persistence for UserService.
+//
+// Every create/update/delete is appended to an in-memory buffer while the
+// caller holds its shard lock, and the caller then waits for it to become
+// durable. A single flusher thread writes whatever has accumulated and issues
+// one fdatasync() for the whole batch (group commit), so concurrent requests
+// share the cost of each sync.
+//
+// Files in the data directory:
+//   wal-<segment>.log  append-only records: [u32 length][u32 crc32][payload]
+//   snapshot.bin       compact image of all users plus the first WAL segment
+//                      that still has to be replayed on top of it
+//
+// Compaction rotates to a new WAL segment, writes a snapshot of the current
+// store, atomically renames it into place and deletes the older segments.
+// Replay is idempotent (creates upsert, deletes ignore missing ids), so
+// records that are both in the snapshot and the new segment are harmless.
+//
+// On startup the snapshot and WAL segments are mmap'd and decoded in place,
+// in parallel across id partitions; a torn record at the end of a segment is
+// truncated away.
+class UserPersistence {
+public:
+    enum class RecordType : uint8_t {
+        Create = 1,
+        Update = 2,
+        Delete = 3
+    };
+
+    struct Options {
+        size_t snapshotEveryRecords = 1000000;  // Compact after this many WAL records (0 disables)
+    };
+
+    // Receives recovered state: upsert/erase users and the next id to assign.
+    // Users are split into partitions by id and each partition is recovered
+    // on its own thread, so upsert/erase must be safe to call concurrently
+    // for ids in different partitions.
+    struct RecoverySink {
+        size_t partitions = 1;
+        std::function<size_t(int)> partitionOf;
+        std::function<void(const User&)> upsert;
+        std::function<void(int)> erase;
+        std::function<void(int)> setNextId;
+    };
+
+    // Produces a consistent, immutable view of all users for a snapshot
+    using SnapshotSource = std::function<std::shared_ptr<const UserColumns>(int& nextId)>;
+
+private:
+    static constexpr char SNAPSHOT_MAGIC[8] = {'U', 'S', 'R', 'S', 'N', 'A', 'P', '1'};
+    static constexpr size_t SNAPSHOT_HEADER_SIZE = 8 + 8 + 4 + 8 + 4;  // magic, segment, nextId, count, crc
+
+    std::string directory;
+    Options options;
+
+    std::mutex mutex;
+    std::condition_variable flushWanted;
+    std::condition_variable flushed;
+    std::string pending;          // Encoded records not yet handed to the flusher
+    uint64_t appendedLsn = 0;
+    uint64_t durableLsn = 0;
+    bool failed = false;
+    bool running = true;
+    bool rotateRequested = false;
+    uint64_t segment = 1;
+    uint64_t rotatedTo = 0;       // Segment created by the last rotation, 0 if it failed
+    uint64_t rotations = 0;       // Completed rotation attempts
+    std::mutex compactMutex;      // Serializes compactions
+    size_t recordsSinceSnapshot = 0;
+
+    int walFd = -1;
+    std::thread flusher;
+    std::thread compactor;
+    SnapshotSource snapshotSource;
+
+    static uint32_t crc32(const char* data, size_t length, uint32_t crc = 0) {
+        static const auto table = [] {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < length; ++i) {
+            crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    template <typename T>
+    static void put(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static bool get(const char*& p, const char* end, T& value) {
+        if (static_cast<size_t>(end - p) < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    // id, age, name and email, shared by WAL payloads and snapshot entries
+    static void encodeUser(std::string& out, const UserView& user) {
+        put<int32_t>(out, user.id);
+        put<int32_t>(out, user.age);
+        put<uint32_t>(out, static_cast<uint32_t>(user.name.size()));
+        put<uint32_t>(out, static_cast<uint32_t>(user.email.size()));
+        out += user.name;
+        out += user.email;
+    }
+
+    static bool decodeUser(const char*& p, const char* end, User& user) {
+        int32_t id, age;
+        uint32_t nameLength, emailLength;
+        if (!get(p, end, id) || !get(p, end, age) || !get(p, end, nameLength) || !get(p, end, emailLength)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - p) < static_cast<size_t>(nameLength) + emailLength) {
+            return false;
+        }
+        user.id = id;
+        user.age = age;
+        user.name.assign(p, nameLength);
+        user.email.assign(p + nameLength, emailLength);
+        p += nameLength + emailLength;
+        return true;
+    }
+
+    std::string segmentPath(uint64_t number) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "wal-%06llu.log", static_cast<unsigned long long>(number));
+        return directory + "/" + name;
+    }
+
+    std::string snapshotPath() const {
+        return directory + "/snapshot.bin";
+    }
+
+#ifndef _WIN32
+    static void syncDirectory(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    static bool writeFully(int fd, const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t written = ::write(fd, data, length);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    static int dataSync(int fd) {
+#ifdef __APPLE__
+        return ::fsync(fd);
+#else
+        return ::fdatasync(fd);
+#endif
+    }
+
+    int openSegment(uint64_t number) {
+        int fd = ::open(segmentPath(number).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open WAL segment " + segmentPath(number));
+        }
+        syncDirectory(directory);
+        return fd;
+    }
+
+    // Existing WAL segment numbers, ascending
+    std::vector<uint64_t> listSegments() const {
+        std::vector<uint64_t> numbers;
+        DIR* dir = ::opendir(directory.c_str());
+        if (!dir) {
+            return numbers;
+        }
+        while (dirent* entry = ::readdir(dir)) {
+            unsigned long long number;
+            char suffix[8];
+            if (std::sscanf(entry->d_name, "wal-%llu.%4s", &number, suffix) == 2 && std::strcmp(suffix, "log") == 0) {
+                numbers.push_back(number);
+            }
+        }
+        ::closedir(dir);
+        std::sort(numbers.begin(), numbers.end());
+        return numbers;
+    }
+
+    // Map a whole file read-only; returns nullptr for a missing or empty file
+    static const char* mapFile(const std::string& path, size_t& size) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        size = static_cast<size_t>(info.st_size);
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Failed to map " + path);
+        }
+        ::madvise(mapped, size, MADV_SEQUENTIAL);
+        return static_cast<const char*>(mapped);
+    }
+
+    // Run fn(partition) for every sink partition, one thread per partition
+    static void forEachPartition(const RecoverySink& sink, const std::function<void(size_t)>& fn) {
+        if (sink.partitions <= 1) {
+            fn(0);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (size_t part = 1; part < sink.partitions; ++part) {
+            workers.emplace_back(fn, part);
+        }
+        fn(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Returns the first WAL segment to replay, or 1 without a snapshot
+    uint64_t loadSnapshot(const RecoverySink& sink) {
+        size_t size = 0;
+        const char* begin = mapFile(snapshotPath(), size);
+        if (!begin) {
+            return 1;
+        }
+        if (size < SNAPSHOT_HEADER_SIZE || std::memcmp(begin, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            ::munmap(const_cast<char*>(begin), size);
+            throw std::runtime_error("Corrupt snapshot " + snapshotPath());
+        }
+
+        const char* end = begin + size;
+        const char* p = begin + sizeof(SNAPSHOT_MAGIC);
+        uint64_t firstSegment = 0, count = 0;
+        int32_t nextId = 1;
+        uint32_t checksum = 0;
+        get(p, end, firstSegment);
+        get(p, end, nextId);
+        get(p, end, count);
+        get(p, end, checksum);
+        const char* body = p;
+
+        // Each partition walks the entry headers and decodes only its own
+        // users, while the checksum is verified alongside
+        std::atomic<bool> valid{true};
+        std::thread verifier([&] {
+            if (crc32(body, static_cast<size_t>(end - body)) != checksum) {
+                valid = false;
+            }
+        });
+
+        forEachPartition(sink, [&](size_t part) {
+            const char* q = body;
+            User user;
+            for (uint64_t i = 0; i < count && valid; ++i) {
+                const char* entry = q;
+                int32_t id, age;
+                uint32_t nameLength, emailLength;
+                if (!get(q, end, id) || !get(q, end, age) || !get(q, end, nameLength) || !get(q, end, emailLength) ||
+                    static_cast<size_t>(end - q) < static_cast<size_t>(nameLength) + emailLength) {
+                    valid = false;
+                    break;
+                }
+                q += nameLength + emailLength;
+
+                if (sink.partitions <= 1 || sink.partitionOf(id) == part) {
+                    decodeUser(entry, end, user);
+                    sink.upsert(user);
+                }
+            }
+        });
+        verifier.join();
+        ::munmap(const_cast<char*>(begin), size);
+
+        if (!valid) {
+            throw std::runtime_error("Corrupt snapshot " + snapshotPath());
+        }
+        sink.setNextId(nextId);
+        return firstSegment;
+    }
+
+    // Replays one segment; returns false if it ended in a torn record, in
+    // which case validLength is the end offset of the last good record
+    static bool replaySegment(const std::string& path, const RecoverySink& sink, size_t& records, off_t& validLength) {
+        size_t size = 0;
+        const char* begin = mapFile(path, size);
+        if (!begin) {
+            return true;
+        }
+
+        // Sequential pass: verify checksums and find the intact prefix
+        const char* p = begin;
+        const char* end = begin + size;
+        User user;
+        while (p < end) {
+            const char* start = p;
+            uint32_t length = 0, checksum = 0;
+            bool good = get(p, end, length) && get(p, end, checksum) &&
+                        static_cast<size_t>(end - p) >= length && crc32(p, length) == checksum;
+
+            uint8_t type = 0;
+            if (good) {
+                const char* payload = p;
+                good = get(payload, p + length, type) && decodeUser(payload, p + length, user);
+            }
+            if (!good) {
+                end = start;
+                break;
+            }
+            ++records;
+            p += length;
+        }
+        bool intact = end == begin + size;
+        validLength = static_cast<off_t>(end - begin);
+
+        // Apply pass: records for an id all land in the same partition, so
+        // per-id order is preserved
+        forEachPartition(sink, [&](size_t part) {
+            const char* q = begin;
+            User record;
+            while (q < end) {
+                uint32_t length = 0, checksum = 0;
+                uint8_t type = 0;
+                get(q, end, length);
+                get(q, end, checksum);
+                const char* payload = q;
+                get(payload, q + length, type);
+                decodeUser(payload, q + length, record);
+                q += length;
+
+                if (sink.partitions > 1 && sink.partitionOf(record.id) != part) {
+                    continue;
+                }
+                if (static_cast<RecordType>(type) == RecordType::Delete) {
+                    sink.erase(record.id);
+                } else {
+                    sink.upsert(record);
+                }
+            }
+        });
+
+        ::munmap(const_cast<char*>(begin), size);
+        return intact;
+    }
+
+    void flusherLoop() {
+        std::string writing;
+        for (;;) {
+            uint64_t target;
+            bool rotate;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                flushWanted.wait(lock, [this] { return !pending.empty() || rotateRequested || !running; });
+                if (pending.empty() && !rotateRequested && !running) {
+                    return;
+                }
+                writing.swap(pending);
+                target = appendedLsn;
+                rotate = rotateRequested;
+                rotateRequested = false;
+            }
+
+            bool ok = writing.empty() || (writeFully(walFd, writing.data(), writing.size()) && dataSync(walFd) == 0);
+            writing.clear();
+
+            uint64_t newSegment = 0;
+            if (ok && rotate) {
+                // Everything appended before the swap is in the old segment
+                uint64_t next;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    next = segment + 1;
+                }
+                try {
+                    int fd = openSegment(next);
+                    ::close(walFd);
+                    walFd = fd;
+                    newSegment = next;
+                } catch (const std::exception& e) {
+                    Logger::error(std::string("WAL rotation failed: ") + e.what());
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (ok) {
+                    durableLsn = target;
+                } else {
+                    failed = true;
+                    Logger::error("WAL write failed in " + directory);
+                }
+                if (rotate) {
+                    if (newSegment != 0) {
+                        segment = newSegment;
+                    }
+                    rotatedTo = newSegment;
+                    ++rotations;
+                }
+            }
+            flushed.notify_all();
+        }
+    }
+
+    void compactorLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            flushed.wait_for(lock, std::chrono::seconds(1));
+            if (running && options.snapshotEveryRecords > 0 && recordsSinceSnapshot >= options.snapshotEveryRecords) {
+                lock.unlock();
+                try {
+                    compact();
+                } catch (const std::exception& e) {
+                    Logger::error(std::string("Snapshot failed: ") + e.what());
+                }
+                lock.lock();
+            }
+        }
+    }
+#endif
+
+public:
+    UserPersistence(const std::string& directory, Options options)
+        : directory(directory), options(options) {
+#ifdef _WIN32
+        throw std::runtime_error("Persistence is not supported on this platform");
+#else
+        ::mkdir(directory.c_str(), 0755);
+#endif
+    }
+
+    ~UserPersistence() {
+#ifndef _WIN32
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        flushWanted.notify_all();
+        flushed.notify_all();
+        if (compactor.joinable()) compactor.join();
+        if (flusher.joinable()) flusher.join();
+        if (walFd >= 0) ::close(walFd);
+#endif
+    }
+
+    UserPersistence(const UserPersistence&) = delete;
+    UserPersistence& operator=(const UserPersistence&) = delete;
+
+    // Load the snapshot and replay the WAL, then start accepting appends.
+    // Returns the number of WAL records replayed.
+    size_t recover(const RecoverySink& sink, SnapshotSource source) {
+        size_t records = 0;
+#ifndef _WIN32
+        snapshotSource = std::move(source);
+        uint64_t firstSegment = loadSnapshot(sink);
+
+        std::vector<uint64_t> segments = listSegments();
+        for (uint64_t number : segments) {
+            if (number < firstSegment) {
+                ::unlink(segmentPath(number).c_str());  // Left over from an interrupted compaction
+                continue;
+            }
+
+            off_t validLength = 0;
+            if (!replaySegment(segmentPath(number), sink, records, validLength)) {
+                Logger::warning("Truncating torn WAL tail in " + segmentPath(number));
+                if (::truncate(segmentPath(number).c_str(), validLength) != 0) {
+                    throw std::runtime_error("Failed to truncate " + segmentPath(number));
+                }
+            }
+        }
+
+        segment = std::max<uint64_t>(firstSegment, segments.empty() ? 1 : segments.back());
+        walFd = openSegment(segment);
+        recordsSinceSnapshot = records;
+        flusher = std::thread(&UserPersistence::flusherLoop, this);
+        compactor = std::thread(&UserPersistence::compactorLoop, this);
+#endif
+        return records;
+    }
+
+    // Queue a record; call with the shard lock held so per-id order matches
+    // the order changes were applied. Returns the record's log sequence number.
+    uint64_t append(RecordType type, const UserView& user) {
+        std::string record;
+        put<uint8_t>(record, static_cast<uint8_t>(type));
+        encodeUser(record, user);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        put<uint32_t>(pending, static_cast<uint32_t>(record.size()));
+        put<uint32_t>(pending, crc32(record.data(), record.size()));
+        pending += record;
+        ++recordsSinceSnapshot;
+        return ++appendedLsn;
+    }
+
+    // Block until every record up to lsn has been synced to disk
+    void waitDurable(uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(mutex);
+        flushWanted.notify_one();
+        flushed.wait(lock, [this, lsn] { return durableLsn >= lsn || failed; });
+        if (failed && durableLsn < lsn) {
+            throw std::runtime_error("Failed to persist change");
+        }
+    }
+
+    // Write a snapshot of the current store and drop the WAL it covers
+    void compact() {
+#ifndef _WIN32
+        std::lock_guard<std::mutex> compactLock(compactMutex);
+
+        uint64_t newSegment;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            uint64_t before = rotations;
+            rotateRequested = true;
+            recordsSinceSnapshot = 0;
+            flushWanted.notify_one();
+            flushed.wait(lock, [this, before] { return rotations != before || !running; });
+            newSegment = rotations != before ? rotatedTo : 0;
+        }
+        if (newSegment == 0) {
+            throw std::runtime_error("WAL rotation failed");
+        }
+
+        // Everything in older segments is already applied to the store
+        int nextId = 1;
+        auto source = snapshotSource(nextId);
+        const UserColumns& users = *source;
+
+        std::string body;
+        for (size_t i = 0; i < users.size(); ++i) {
+            encodeUser(body, users[i]);
+        }
+
+        std::string file(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        put<uint64_t>(file, newSegment);
+        put<int32_t>(file, nextId);
+        put<uint64_t>(file, users.size());
+        put<uint32_t>(file, crc32(body.data(), body.size()));
+        file += body;
+
+        std::string temp = snapshotPath() + ".tmp";
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || !writeFully(fd, file.data(), file.size()) || ::fsync(fd) != 0) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("Failed to write " + temp);
+        }
+        ::close(fd);
+        if (::rename(temp.c_str(), snapshotPath().c_str()) != 0) {
+            throw std::runtime_error("Failed to install " + snapshotPath());
+        }
+        syncDirectory(directory);
+
+        for (uint64_t number : listSegments()) {
+            if (number < newSegment) {
+                ::unlink(segmentPath(number).c_str());
+            }
+        }
+        Logger::info("Wrote snapshot of " + std::to_string(users.size()) + " users to " + snapshotPath());
+#endif
+    }
+};
+
+#endif // USER_PERSISTENCE_HPP
@@ -4,79 +4,727 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
 #include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
 #include "../models/User.hpp"
+#include "../models/BulkOperation.hpp"
+#include "UserStore.hpp"
+#include "UserColumns.hpp"
+#include "UserPersistence.hpp"
+#include "SharedUserStore.hpp"
+#include "EmailIndex.hpp"
+#include "ChangeLog.hpp"
+#include "../utils/Metrics.hpp"
 
+// Thread-safe user service.
+//
+// Users are split across a power-of-two number of shards keyed by id, each
+// guarded by its own shared_mutex, so concurrent reads never block each other
+// and writes only serialize with operations on the same shard.
+//
+// Full-list readers use an immutable, reference-counted snapshot of all users
+// in id order, stored column-wise like the shards (see UserColumns). Every
+// write bumps a store version; the first reader to see a stale snapshot
+// rebuilds it and publishes it atomically, and everyone else just takes a
+// reference to the current one without locking or copying.
+// Each user also carries the store version of its own last change, which
+// UserController uses for ETags and its response cache.
+//
+// Emails are unique (compared normalized, see User::normalizeEmail) and
+// indexed in an EmailIndex shared by all shards; each shard also keeps its
+// users ordered by age for range queries.
+//
+// Every change is also appended to a ChangeLog, which backs the change feed;
+// it keeps one ring per shard, so the log adds no lock shared across shards.
+//
+// With enablePersistence(), every change is also written to a WAL (see
+// UserPersistence) and write calls return only once the change is durable.
+//
+// With useSharedStore(), users live in a SharedUserStore shared by all worker
+// processes instead of the local shards; snapshots are still built and
+// cached per process, keyed on the shared store's version. The change log is
+// disabled in this mode, since it would only see this process's writes.
 class UserService {
+public:
+    struct Snapshot {
+        uint64_t version = 0;
+        UserColumns users;  // Sorted by id
+
+        // Positions in users ordered by (age, id), built on first use. Only
+        // needed with a shared store, which has no age index of its own.
+        const std::vector<uint32_t>& byAge() const {
+            std::call_once(ageOnce, [this] {
+                ageOrder.resize(users.size());
+                for (uint32_t i = 0; i < ageOrder.size(); ++i) {
+                    ageOrder[i] = i;
+                }
+                std::sort(ageOrder.begin(), ageOrder.end(), [this](uint32_t a, uint32_t b) {
+                    return users.age(a) != users.age(b) ? users.age(a) < users.age(b) : a < b;
+                });
+            });
+            return ageOrder;
+        }
+
+    private:
+        mutable std::once_flag ageOnce;
+        mutable std::vector<uint32_t> ageOrder;
+    };
+
+    struct Page {
+        std::vector<User> users;  // Sorted by id (by age, then id, for age queries)
+        bool hasMore;
+    };
+
+    using BulkResult = ::BulkResult;
+
+    struct ShardStats {
+        size_t users;
+        uint64_t contended;  // Lock acquisitions that had to wait
+    };
+
 private:
-    std::vector<User> users;
-    int nextId;
-    mutable std::mutex usersMutex;
+    struct alignas(64) Shard {
+        UserStore users;
+        mutable std::shared_mutex mutex;
+        mutable std::atomic<uint64_t> contended{0};
+
+        // Count and time acquisitions that could not be satisfied immediately
+        std::shared_lock<std::shared_mutex> readLock() const {
+            std::shared_lock<std::shared_mutex> lock(mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                contended.fetch_add(1, std::memory_order_relaxed);
+                uint64_t start = Metrics::now();
+                lock.lock();
+                Metrics::recordLockWait(Metrics::LockMode::Read, Metrics::now() - start);
+            }
+            return lock;
+        }
+
+        std::unique_lock<std::shared_mutex> writeLock() const {
+            std::unique_lock<std::shared_mutex> lock(mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                contended.fetch_add(1, std::memory_order_relaxed);
+                uint64_t start = Metrics::now();
+                lock.lock();
+                Metrics::recordLockWait(Metrics::LockMode::Write, Metrics::now() - start);
+            }
+            return lock;
+        }
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t shardCount;
+    std::atomic<int> nextId;
+    EmailIndex emails;  // Lock order: shard, then email stripe
+    ChangeLog changeLog;  // One ring per shard, appended under the shard lock
+
+    std::atomic<uint64_t> version;
+    mutable std::shared_ptr<const Snapshot> snapshot;  // Accessed with std::atomic_load/store
+    mutable std::mutex snapshotMutex;                  // Serializes snapshot rebuilds
+
+    std::shared_ptr<SharedUserStore> shared;           // Replaces the local shards when set
+    std::unique_ptr<UserPersistence> persistence;      // Optional; declared last so it stops first
+
+    static size_t roundUpPowerOfTwo(size_t n) {
+        size_t result = 1;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    size_t shardIndex(int id) const {
+        return static_cast<uint32_t>(id) & (shardCount - 1);
+    }
+
+    Shard& shardFor(int id) const {
+        return shards[shardIndex(id)];
+    }
+
+    // Called with the shard write lock held, after a successful mutation and
+    // before its WAL record is appended: a compaction that rotates the WAL
+    // past the record must then see the change in the snapshot it takes.
+    // Returns the new version, which is stamped on the changed users.
+    uint64_t markChanged() {
+        return version.fetch_add(1, std::memory_order_release) + 1;
+    }
+
+    // Queue a WAL record; call with the shard write lock held, after
+    // markChanged(). Returns 0 when persistence is disabled.
+    uint64_t logChange(UserPersistence::RecordType type, const UserView& user) {
+        return persistence ? persistence->append(type, user) : 0;
+    }
+
+    // Move the email index entry of user id from oldEmail to email; false if
+    // another user has it.
+    // Call with the user's shard write lock held.
+    bool changeEmail(int id, std::string_view oldEmail, const std::string& email) {
+        std::string oldKey = User::normalizeEmail(oldEmail);
+        std::string newKey = User::normalizeEmail(email);
+        if (newKey == oldKey) {
+            return true;
+        }
+        if (!emails.reserve(newKey, id)) {
+            return false;
+        }
+        emails.release(oldKey, id);
+        return true;
+    }
+
+    // Call after releasing the shard lock
+    void waitDurable(uint64_t lsn) {
+        if (lsn != 0) {
+            persistence->waitDurable(lsn);
+        }
+    }
+
+    static std::shared_ptr<Snapshot> emptySnapshot(uint64_t version) {
+        auto empty = std::make_shared<Snapshot>();
+        empty->version = version;
+        return empty;
+    }
+
+    uint64_t currentVersion() const {
+        return shared ? shared->version() : version.load(std::memory_order_acquire);
+    }
+
+    std::shared_ptr<const Snapshot> buildSnapshot() const {
+        auto next = std::make_shared<Snapshot>();
+        // Read the version first: a write racing with the copy leaves the
+        // snapshot tagged as stale, so the next reader rebuilds it
+        next->version = currentVersion();
+
+        if (shared) {
+            shared->collect(next->users);
+        } else {
+            for (size_t i = 0; i < shardCount; ++i) {
+                auto lock = shards[i].readLock();
+                shards[i].users.forEach([&next](const UserView& user) { next->users.push_back(user); });
+            }
+        }
+
+        // Slots are recycled and ids are spread over shards, so restore
+        // creation (id) order for callers
+        next->users.sortById();
+        return next;
+    }
 
 public:
-    UserService() : nextId(1) {}
+    static constexpr size_t DEFAULT_CHANGE_LOG_SIZE = 65536;
+
+    static size_t defaultShardCount() {
+        size_t cores = std::thread::hardware_concurrency();
+        return cores == 0 ? 16 : cores * 4;
+    }
+
+    explicit UserService(size_t shards = defaultShardCount())
+        : shardCount(roundUpPowerOfTwo(std::max<size_t>(shards, 1))), nextId(1), emails(shardCount),
+          changeLog(DEFAULT_CHANGE_LOG_SIZE, shardCount), version(0), snapshot(emptySnapshot(0)) {
+        this->shards.reset(new Shard[shardCount]);
+    }
+
+    // Keep users in a store shared with other worker processes. Call once,
+    // before serving requests; not combinable with persistence.
+    void useSharedStore(std::shared_ptr<SharedUserStore> store) {
+        if (persistence) {
+            throw std::logic_error("Shared store cannot be combined with persistence");
+        }
+        shared = std::move(store);
+        snapshot = emptySnapshot(~uint64_t(0));
+        changeLog.setCapacity(0);
+    }
+
+    // Recent changes, for the change feed
+    ChangeLog& changes() {
+        return changeLog;
+    }
+
+    // Longest name or email the store accepts
+    size_t maxFieldLength() const {
+        return shared ? SharedUserStore::MAX_FIELD_LENGTH : SIZE_MAX;
+    }
+
+    // Load users from a data directory and log all further changes to it.
+    // Call once, before serving requests. Returns the WAL records replayed.
+    size_t enablePersistence(const std::string& directory, UserPersistence::Options options = {}) {
+        if (shared) {
+            throw std::logic_error("Persistence cannot be combined with a shared store");
+        }
+        auto store = std::make_unique<UserPersistence>(directory, options);
+
+        // Recover with one thread per group of shards; no locks are needed
+        // because each shard is only touched by its own thread
+        size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), shardCount));
+        UserPersistence::RecoverySink sink;
+        sink.partitions = threads;
+        sink.partitionOf = [this, threads](int id) {
+            return (static_cast<uint32_t>(id) & (shardCount - 1)) % threads;
+        };
+        sink.upsert = [this](const User& user) {
+            UserStore& users = shardFor(user.id).users;
+            if (!users.update(user.id, user, user.version)) {
+                users.insert(user);
+            }
+        };
+        sink.erase = [this](int id) {
+            shardFor(id).users.erase(id);
+        };
+        sink.setNextId = [this](int id) {
+            nextId.store(id);
+        };
+
+        size_t replayed = store->recover(sink, [this](int& next) {
+            auto current = getSnapshot();
+            next = nextId.load();
+            return std::shared_ptr<const UserColumns>(current, &current->users);
+        });
+
+        int maxId = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            maxId = std::max(maxId, shards[i].users.maxId());
+        }
+        if (nextId.load() <= maxId) {
+            nextId.store(maxId + 1);
+        }
+        markChanged();
+
+        // Index emails once the final state is known (the version bump above
+        // makes the snapshot current). Data written before emails were unique
+        // may hold duplicates: the oldest user keeps the index entry.
+        auto current = getSnapshot();
+        for (size_t i = 0; i < current->users.size(); ++i) {
+            UserView user = current->users[i];
+            emails.reserve(User::normalizeEmail(user.email), user.id);
+        }
+        persistence = std::move(store);
+        return replayed;
+    }
+
+    // Write a snapshot now and drop the WAL it covers
+    void compact() {
+        if (persistence) {
+            persistence->compact();
+        }
+    }
+
+    // Current immutable view of all users, ordered by id
+    std::shared_ptr<const Snapshot> getSnapshot() const {
+        auto current = std::atomic_load(&snapshot);
+        if (current->version == currentVersion()) {
+            return current;
+        }
+
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        current = std::atomic_load(&snapshot);
+        if (current->version == currentVersion()) {
+            return current;  // Another reader rebuilt it while we waited
+        }
+
+        auto next = buildSnapshot();
+        std::atomic_store(&snapshot, next);
+        return next;
+    }
+
+    // Version of the store as a whole; changes with every write
+    uint64_t getVersion() const {
+        return currentVersion();
+    }
+
+    // Version of the user's last change, without copying the user; false if absent
+    bool getUserVersion(int id, uint64_t& userVersion) const {
+        if (shared) {
+            return shared->findVersion(id, userVersion);
+        }
+
+        Shard& shard = shardFor(id);
+        auto lock = shard.readLock();
+        UserView user;
+        if (!shard.users.find(id, user)) {
+            return false;
+        }
+        userVersion = user.version;
+        return true;
+    }
 
     // Get all users
     std::vector<User> getAllUsers() const {
-        std::lock_guard<std::mutex> lock(usersMutex);
+        auto current = getSnapshot();
+        std::vector<User> users;
+        users.reserve(current->users.size());
+        for (size_t i = 0; i < current->users.size(); ++i) {
+            users.push_back(current->users[i].toUser());
+        }
         return users;
     }
 
-    // Get user by ID
-    std::shared_ptr<User> getUserById(int id) const {
-        std::lock_guard<std::mutex> lock(usersMutex);
-        auto it = std::find_if(users.begin(), users.end(),
-            [id](const User& user) { return user.id == id; });
-        
-        if (it != users.end()) {
-            return std::make_shared<User>(*it);
+    // Up to `limit` users with id > afterId, in id order. Cost depends on the
+    // page size and shard count, not on the number of stored users.
+    Page getUsersPage(int afterId, size_t limit) const {
+        Page page{{}, false};
+        if (limit == 0) {
+            return page;
+        }
+
+        if (shared) {
+            // No ordered index in shared memory: page through the snapshot
+            auto current = getSnapshot();
+            const auto& ids = current->users.idColumn();
+            size_t first = static_cast<size_t>(std::upper_bound(ids.begin(), ids.end(), afterId) - ids.begin());
+            size_t available = ids.size() - first;
+            for (size_t i = first; i < first + std::min(available, limit); ++i) {
+                page.users.push_back(current->users[i].toUser());
+            }
+            page.hasMore = available > limit;
+            return page;
+        }
+
+        // Pass 1: collect at most limit + 1 candidate ids per shard to find
+        // the id range the page covers without copying any users
+        std::vector<int> ids;
+        for (size_t i = 0; i < shardCount; ++i) {
+            auto lock = shards[i].readLock();
+            size_t taken = 0;
+            shards[i].users.forEachAfter(afterId, [&ids, &taken, limit](const UserView& user) {
+                ids.push_back(user.id);
+                return ++taken <= limit;
+            });
+        }
+
+        int lastId = INT_MAX;
+        if (ids.size() > limit) {
+            std::nth_element(ids.begin(), ids.begin() + limit, ids.end());
+            lastId = *std::max_element(ids.begin(), ids.begin() + limit);
+            page.hasMore = true;
+        }
+
+        // Pass 2: copy only the users inside (afterId, lastId]
+        page.users.reserve(std::min(ids.size(), limit));
+        for (size_t i = 0; i < shardCount; ++i) {
+            auto lock = shards[i].readLock();
+            shards[i].users.forEachAfter(afterId, [&page, lastId](const UserView& user) {
+                if (user.id > lastId) {
+                    return false;
+                }
+                page.users.push_back(user.toUser());
+                return true;
+            });
+        }
+
+        std::sort(page.users.begin(), page.users.end(),
+            [](const User& a, const User& b) { return a.id < b.id; });
+        if (page.users.size() > limit) {
+            // Users created between the two passes
+            page.users.resize(limit);
+            page.hasMore = true;
+        }
+        return page;
+    }
+
+    // Up to `limit` users with minAge <= age <= maxAge, ordered by (age, id)
+    // and starting after the pair `after`. Two passes like getUsersPage().
+    Page getUsersByAge(int minAge, int maxAge, std::pair<int, int> after, size_t limit) const {
+        Page page{{}, false};
+        after = std::max(after, std::make_pair(minAge, INT_MIN));
+        if (limit == 0 || minAge > maxAge) {
+            return page;
+        }
+
+        auto byAge = [](const User& a, const User& b) {
+            return a.age != b.age ? a.age < b.age : a.id < b.id;
+        };
+
+        if (shared) {
+            auto current = getSnapshot();
+            const auto& order = current->byAge();
+            auto first = std::upper_bound(order.begin(), order.end(), after,
+                [&current](std::pair<int, int> key, uint32_t i) {
+                    return key < std::make_pair(current->users.age(i), current->users.id(i));
+                });
+            for (auto it = first; it != order.end() && current->users.age(*it) <= maxAge; ++it) {
+                if (page.users.size() == limit) {
+                    page.hasMore = true;
+                    break;
+                }
+                page.users.push_back(current->users[*it].toUser());
+            }
+            return page;
+        }
+
+        // Pass 1: find the last (age, id) on the page from at most limit + 1
+        // candidates per shard
+        std::vector<std::pair<int, int>> keys;
+        for (size_t i = 0; i < shardCount; ++i) {
+            auto lock = shards[i].readLock();
+            size_t taken = 0;
+            shards[i].users.forEachByAge(after, maxAge, [&keys, &taken, limit](const UserView& user) {
+                keys.emplace_back(user.age, user.id);
+                return ++taken <= limit;
+            });
+        }
+
+        std::pair<int, int> last(maxAge, INT_MAX);
+        if (keys.size() > limit) {
+            std::nth_element(keys.begin(), keys.begin() + limit, keys.end());
+            last = *std::max_element(keys.begin(), keys.begin() + limit);
+            page.hasMore = true;
+        }
+
+        // Pass 2: copy only the users inside (after, last]
+        page.users.reserve(std::min(keys.size(), limit));
+        for (size_t i = 0; i < shardCount; ++i) {
+            auto lock = shards[i].readLock();
+            shards[i].users.forEachByAge(after, last.first, [&page, last](const UserView& user) {
+                if (std::make_pair(user.age, user.id) > last) {
+                    return false;
+                }
+                page.users.push_back(user.toUser());
+                return true;
+            });
+        }
+
+        std::sort(page.users.begin(), page.users.end(), byAge);
+        if (page.users.size() > limit) {
+            // Users created or changed between the two passes
+            page.users.resize(limit);
+            page.hasMore = true;
+        }
+        return page;
+    }
+
+    // Copy the user with this email, compared normalized, into user; false
+    // if there is none
+    bool findUserByEmail(const std::string& email, User& user) const {
+        if (shared) {
+            return shared->findByEmail(email, user);
+        }
+
+        std::string key = User::normalizeEmail(email);
+        int id = emails.find(key);
+        // The index is updated under the shard lock, so re-check: the user
+        // may have changed email since the lookup
+        return id != 0 && getUserById(id, user) && User::normalizeEmail(user.email) == key;
+    }
+
+    // Copy the user with this id into user; false if there is none
+    bool getUserById(int id, User& user) const {
+        if (shared) {
+            return shared->find(id, user);
         }
-        return nullptr;
+
+        Shard& shard = shardFor(id);
+        auto lock = shard.readLock();
+        UserView found;
+        if (!shard.users.find(id, found)) {
+            return false;
+        }
+        found.copyTo(user);
+        return true;
     }
 
-    // Create new user
-    User createUser(const User& user) {
-        std::lock_guard<std::mutex> lock(usersMutex);
+    // Create new user; Conflict if the email is taken, Full if the shared
+    // store has no room left
+    WriteResult createUser(const User& user, User& created) {
+        if (shared) {
+            return shared->create(user, created);
+        }
+
+        // Claim the email before taking an id, so a conflict does not use
+        // one up
+        std::string key = User::normalizeEmail(user.email);
+        if (!emails.claim(key)) {
+            return WriteResult::Conflict;
+        }
         User newUser = user;
-        newUser.id = nextId++;
-        users.push_back(newUser);
-        return newUser;
-    }
-
-    // Update user
-    bool updateUser(int id, const User& updatedUser) {
-        std::lock_guard<std::mutex> lock(usersMutex);
-        auto it = std::find_if(users.begin(), users.end(),
-            [id](const User& user) { return user.id == id; });
-        
-        if (it != users.end()) {
-            it->name = updatedUser.name;
-            it->email = updatedUser.email;
-            it->age = updatedUser.age;
-            return true;
+        newUser.id = nextId.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t lsn;
+        {
+            Shard& shard = shardFor(newUser.id);
+            auto lock = shard.writeLock();
+            emails.assign(key, newUser.id);
+            newUser.version = markChanged();
+            shard.users.insert(newUser);
+            lsn = logChange(UserPersistence::RecordType::Create, newUser.view());
+            changeLog.append(shardIndex(newUser.id), ChangeLog::Type::Create, newUser.view());
         }
-        return false;
+        waitDurable(lsn);
+        created = newUser;
+        return WriteResult::Ok;
+    }
+
+    // Update user; Conflict if the new email belongs to another user, Full
+    // if the shared store has no room left for it
+    WriteResult updateUser(int id, const User& updatedUser) {
+        if (shared) {
+            return shared->update(id, updatedUser);
+        }
+
+        uint64_t lsn;
+        {
+            Shard& shard = shardFor(id);
+            auto lock = shard.writeLock();
+            UserView user;
+            if (!shard.users.find(id, user)) {
+                return WriteResult::NotFound;
+            }
+            if (!changeEmail(id, user.email, updatedUser.email)) {
+                return WriteResult::Conflict;
+            }
+
+            uint64_t changed = markChanged();
+            shard.users.update(id, updatedUser, changed);
+            UserView updated{id, updatedUser.name, updatedUser.email, updatedUser.age, changed};
+            lsn = logChange(UserPersistence::RecordType::Update, updated);
+            changeLog.append(shardIndex(id), ChangeLog::Type::Update, updated);
+        }
+        waitDurable(lsn);
+        return WriteResult::Ok;
     }
 
     // Delete user
     bool deleteUser(int id) {
-        std::lock_guard<std::mutex> lock(usersMutex);
-        auto it = std::find_if(users.begin(), users.end(),
-            [id](const User& user) { return user.id == id; });
-        
-        if (it != users.end()) {
-            users.erase(it);
-            return true;
+        if (shared) {
+            return shared->erase(id);
         }
-        return false;
+
+        uint64_t lsn;
+        {
+            Shard& shard = shardFor(id);
+            auto lock = shard.writeLock();
+            UserView user;
+            if (!shard.users.find(id, user)) {
+                return false;
+            }
+            emails.release(User::normalizeEmail(user.email), id);
+            shard.users.erase(id);
+
+            UserView deleted{id, {}, {}, 0, markChanged()};
+            lsn = logChange(UserPersistence::RecordType::Delete, deleted);
+            changeLog.append(shardIndex(id), ChangeLog::Type::Delete, deleted);
+        }
+        waitDurable(lsn);
+        return true;
+    }
+
+    // Apply a validated batch of operations. Operations are grouped by shard
+    // and each shard's group runs under a single write lock, in request order,
+    // so operations on the same id keep their relative order. Creates and
+    // updates to a taken email get status 409; which of two operations in
+    // different shards claiming the same email wins is unspecified.
+    std::vector<BulkResult> applyBulk(const std::vector<BulkOperation>& ops) {
+        if (shared) {
+            return shared->applyBulk(ops);
+        }
+
+        std::vector<BulkResult> results(ops.size(), BulkResult{0, 404});
+
+        // Reserve one contiguous id block for all creates, in request order
+        size_t creates = std::count_if(ops.begin(), ops.end(),
+            [](const BulkOperation& op) { return op.type == BulkOperation::Type::Create; });
+        int id = nextId.fetch_add(static_cast<int>(creates), std::memory_order_relaxed);
+
+        std::vector<std::vector<size_t>> byShard(shardCount);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            results[i].id = ops[i].type == BulkOperation::Type::Create ? id++ : ops[i].user.id;
+            byShard[static_cast<uint32_t>(results[i].id) & (shardCount - 1)].push_back(i);
+        }
+
+        uint64_t lsn = 0;
+        for (size_t s = 0; s < shardCount; ++s) {
+            if (byShard[s].empty()) {
+                continue;
+            }
+
+            Shard& shard = shards[s];
+            auto lock = shard.writeLock();
+            // Bump the version before any WAL append, as for single writes
+            uint64_t changed = markChanged();
+            for (size_t i : byShard[s]) {
+                const BulkOperation& op = ops[i];
+                BulkResult& result = results[i];
+
+                if (op.type == BulkOperation::Type::Create) {
+                    User newUser = op.user;
+                    newUser.id = result.id;
+                    if (!emails.reserve(User::normalizeEmail(newUser.email), newUser.id)) {
+                        result.status = 409;
+                        continue;
+                    }
+                    newUser.version = changed;
+                    shard.users.insert(newUser);
+                    result.status = 201;
+                    lsn = std::max(lsn, logChange(UserPersistence::RecordType::Create, newUser.view()));
+                    changeLog.append(s, ChangeLog::Type::Create, newUser.view());
+                    continue;
+                }
+
+                UserView user;
+                if (!shard.users.find(result.id, user)) {
+                    continue;  // 404
+                }
+                if (op.type == BulkOperation::Type::Update) {
+                    if (!changeEmail(result.id, user.email, op.user.email)) {
+                        result.status = 409;
+                        continue;
+                    }
+                    shard.users.update(result.id, op.user, changed);
+                    result.status = 200;
+                    UserView updated{result.id, op.user.name, op.user.email, op.user.age, changed};
+                    lsn = std::max(lsn, logChange(UserPersistence::RecordType::Update, updated));
+                    changeLog.append(s, ChangeLog::Type::Update, updated);
+                } else {
+                    emails.release(User::normalizeEmail(user.email), result.id);
+                    shard.users.erase(result.id);
+                    result.status = 200;
+                    UserView deleted{result.id, {}, {}, 0, changed};
+                    lsn = std::max(lsn, logChange(UserPersistence::RecordType::Delete, deleted));
+                    changeLog.append(s, ChangeLog::Type::Delete, deleted);
+                }
+            }
+        }
+
+        // One durability wait covers the whole batch
+        waitDurable(lsn);
+        return results;
     }
 
     // Check if user exists
     bool userExists(int id) const {
-        std::lock_guard<std::mutex> lock(usersMutex);
-        return std::find_if(users.begin(), users.end(),
-            [id](const User& user) { return user.id == id; }) != users.end();
+        if (shared) {
+            User user;
+            return shared->find(id, user);
+        }
+
+        Shard& shard = shardFor(id);
+        auto lock = shard.readLock();
+        return shard.users.contains(id);
+    }
+
+    // Per-shard size and lock contention counters
+    std::vector<ShardStats> getShardStats() const {
+        std::vector<ShardStats> stats;
+        if (shared) {
+            for (const auto& shard : shared->getShardStats()) {
+                stats.push_back(ShardStats{shard.users, shard.contended});
+            }
+            return stats;
+        }
+
+        stats.reserve(shardCount);
+        for (size_t i = 0; i < shardCount; ++i) {
+            auto lock = shards[i].readLock();
+            stats.push_back(ShardStats{
+                shards[i].users.size(),
+                shards[i].contended.load(std::memory_order_relaxed)
+            });
+        }
+        return stats;
     }
 };
 
-#endif // USER_SERVICE_HPP
\ No newline at end of file
+#endif // USER_SERVICE_HPP
@@ -0,0 +1,217 @@
+#ifndef USER_STORE_HPP
+#define USER_STORE_HPP
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "../models/User.hpp"
+#include "SortedBlocks.hpp"
+#include "UserColumns.hpp"
+
+// Indexed in-memory user storage.
+//
+// Users live in the slots of a UserColumns table; freed slots are recycled
+// through a free list so memory use stays stable under create/delete churn.
+// An open-addressing hash table (linear probing, backward-shift deletion)
+// maps id -> slot, giving O(1) lookup, update and delete without shifting
+// the rest of the table. Ids in sorted blocks support cursor-style scans in
+// id order, and (age, id) pairs in sorted blocks support age range scans;
+// neither allocates per user. Lookups and scans hand out UserViews, which are invalidated
+// by the next change to the store.
+//
+// Not thread-safe: callers (UserService) are responsible for locking.
+class UserStore {
+private:
+    struct Bucket {
+        int id;
+        uint32_t slot;
+    };
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr size_t INITIAL_BUCKETS = 16;
+
+    UserColumns slots;                // Dense storage; a free slot has id == 0
+    std::vector<uint32_t> freeSlots;  // Recycled slot indices
+    std::vector<Bucket> buckets;      // Power-of-two sized id -> slot table
+    SortedBlocks<int> orderedIds;     // Ids in ascending order, for cursor scans
+    SortedBlocks<std::pair<int, int>> byAge;  // (age, id) in ascending order, for age ranges
+    size_t count;
+
+    static size_t hashId(int id) {
+        // Fibonacci hashing spreads sequential ids across the table
+        return static_cast<size_t>(static_cast<uint64_t>(static_cast<uint32_t>(id)) * 0x9E3779B97F4A7C15ULL >> 32);
+    }
+
+    size_t mask() const {
+        return buckets.size() - 1;
+    }
+
+    // Returns the bucket index holding id, or buckets.size() if absent
+    size_t findBucket(int id) const {
+        size_t i = hashId(id) & mask();
+        while (buckets[i].slot != EMPTY) {
+            if (buckets[i].id == id) {
+                return i;
+            }
+            i = (i + 1) & mask();
+        }
+        return buckets.size();
+    }
+
+    void insertBucket(int id, uint32_t slot) {
+        size_t i = hashId(id) & mask();
+        while (buckets[i].slot != EMPTY) {
+            i = (i + 1) & mask();
+        }
+        buckets[i] = Bucket{id, slot};
+    }
+
+    // Keep the load factor at or below 1/2
+    void growIfNeeded() {
+        if ((count + 1) * 2 <= buckets.size()) {
+            return;
+        }
+        std::vector<Bucket> old(buckets.size() * 2, Bucket{0, EMPTY});
+        old.swap(buckets);
+        for (const auto& bucket : old) {
+            if (bucket.slot != EMPTY) {
+                insertBucket(bucket.id, bucket.slot);
+            }
+        }
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    void eraseBucket(size_t hole) {
+        size_t i = hole;
+        for (;;) {
+            i = (i + 1) & mask();
+            if (buckets[i].slot == EMPTY) {
+                break;
+            }
+            size_t home = hashId(buckets[i].id) & mask();
+            // Move the entry back if its home position is not in (hole, i]
+            if (((i - home) & mask()) >= ((i - hole) & mask())) {
+                buckets[hole] = buckets[i];
+                hole = i;
+            }
+        }
+        buckets[hole] = Bucket{0, EMPTY};
+    }
+
+public:
+    UserStore() : buckets(INITIAL_BUCKETS, Bucket{0, EMPTY}), count(0) {}
+
+    size_t size() const {
+        return count;
+    }
+
+    // View of the user with this id; false if absent
+    bool find(int id, UserView& user) const {
+        size_t b = findBucket(id);
+        if (b == buckets.size()) {
+            return false;
+        }
+        user = slots[buckets[b].slot];
+        return true;
+    }
+
+    bool contains(int id) const {
+        return findBucket(id) != buckets.size();
+    }
+
+    // Insert a user, version included, whose id is not already present
+    void insert(const User& user) {
+        growIfNeeded();
+
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            slots.assign(slot, user.view());
+        } else {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.push_back(user.view());
+        }
+
+        insertBucket(user.id, slot);
+        orderedIds.insert(user.id);
+        byAge.insert(std::make_pair(user.age, user.id));
+        ++count;
+    }
+
+    // Replace a stored user's name, email and age and set its version;
+    // false if id is absent
+    bool update(int id, const User& values, uint64_t version) {
+        size_t b = findBucket(id);
+        if (b == buckets.size()) {
+            return false;
+        }
+
+        uint32_t slot = buckets[b].slot;
+        int oldAge = slots.age(slot);
+        if (oldAge != values.age) {
+            byAge.erase(std::make_pair(oldAge, id));
+            byAge.insert(std::make_pair(values.age, id));
+        }
+        slots.assign(slot, UserView{id, values.name, values.email, values.age, version});
+        return true;
+    }
+
+    bool erase(int id) {
+        size_t b = findBucket(id);
+        if (b == buckets.size()) {
+            return false;
+        }
+
+        uint32_t slot = buckets[b].slot;
+        orderedIds.erase(id);
+        byAge.erase(std::make_pair(slots.age(slot), id));
+        slots.clear(slot);
+        freeSlots.push_back(slot);
+
+        eraseBucket(b);
+        --count;
+        return true;
+    }
+
+    // Largest stored id, or 0 when empty
+    int maxId() const {
+        return orderedIds.empty() ? 0 : orderedIds.back();
+    }
+
+    // Bytes allocated for records, text and indexes
+    size_t memoryUsage() const {
+        return slots.memoryUsage() + freeSlots.capacity() * sizeof(uint32_t) + buckets.capacity() * sizeof(Bucket) +
+               orderedIds.memoryUsage() + byAge.memoryUsage();
+    }
+
+    // Visit every stored user in slot order (not id order)
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots.id(i) != 0) {
+                fn(slots[i]);
+            }
+        }
+    }
+
+    // Visit users with id > afterId in ascending id order until fn returns false
+    template <typename Fn>
+    void forEachAfter(int afterId, Fn&& fn) const {
+        orderedIds.forEachAfter(afterId, [&](int id) {
+            return fn(slots[buckets[findBucket(id)].slot]);
+        });
+    }
+
+    // Visit users ordered by (age, id), starting after the pair `after` and
+    // stopping past maxAge or when fn returns false
+    template <typename Fn>
+    void forEachByAge(std::pair<int, int> after, int maxAge, Fn&& fn) const {
+        byAge.forEachAfter(after, [&](const std::pair<int, int>& key) {
+            return key.first <= maxAge && fn(slots[buckets[findBucket(key.second)].slot]);
+        });
+    }
+};
+
+#endif // USER_STORE_HPP
@@ -0,0 +1,253 @@
+#ifndef ADMISSION_CONTROL_HPP
+#define ADMISSION_CONTROL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "../../external/httplib.h"
+#include "../../external/nlohmann/json.hpp"
+#include "Metrics.hpp"
+#include "Response.hpp"
+
+// Admission control: turns requests away with a fast 503 before any
+// UserService or serialization work is done for them.
+//
+// httplib queues each accepted connection until a worker thread is free.
+// TimedQueue wraps the server's task queue and measures how long each
+// connection waited there, up to the moment a worker picked it up (time
+// the client then takes to send its request does not count); admit() runs
+// before each routed handler and
+//  - sheds the connection's first request if it waited longer than the
+//    queue deadline, since its client has likely given up and serving it
+//    would only delay everything queued behind it, then
+//  - sheds the request if its class (reads: GET and HEAD, writes: the rest)
+//    already has as many requests in flight as its concurrency limit.
+//
+// The limits adapt AIMD-style every WINDOW. A class that reached its limit
+// in the last window while its requests took more than twice their usual
+// latency has the limit cut by a quarter; otherwise the limit grows by one.
+// The usual latency is a moving average over about 16 windows, so it soon
+// follows a change in the request mix, and after a while of overload the
+// limit climbs back to probe for spare capacity. Limits stay between
+// minConcurrency, high enough to keep goodput up, and maxConcurrency, which
+// should be below the worker count so a class can reach its limit while
+// the pool still has workers to spare. Shed responses carry
+// Retry-After and Connection: close, so the worker moves on to a queued
+// connection instead of the shed client's next request.
+//
+// /health, /metrics and the change feed are never shed: probes must keep
+// seeing the server, and feed requests hold a worker by design and have a
+// cap of their own.
+class AdmissionControl {
+public:
+    using Class = Metrics::RequestClass;
+
+    struct Options {
+        size_t maxConcurrency = 1;  // Per class; the limits start here
+        size_t minConcurrency = 1;  // Per class; adaptive limits never go below it
+        uint64_t queueDeadline = 0; // Nanoseconds; 0 disables deadline shedding
+        bool adaptive = true;       // False keeps the limits at maxConcurrency
+    };
+
+    static constexpr uint64_t WINDOW = 100000000;  // Nanoseconds between limit adjustments
+
+    // httplib task queue that records how long each connection waited for a
+    // worker, for admit() on the worker thread that picks it up
+    class TimedQueue : public httplib::TaskQueue {
+    public:
+        explicit TimedQueue(httplib::TaskQueue* inner) : inner(inner) {}
+
+        bool enqueue(std::function<void()> fn) override {
+            uint64_t queued = Metrics::now();
+            return inner->enqueue([fn = std::move(fn), queued] {
+                uint64_t now = Metrics::now();
+                Worker& worker = current();
+                worker.queueWait = now > queued ? now - queued : 0;
+                worker.waitPending = true;
+                fn();
+                worker.waitPending = false;
+                release(worker);  // In case the connection broke before the logger ran
+            });
+        }
+
+        void shutdown() override {
+            inner->shutdown();
+        }
+
+        void on_idle() override {
+            inner->on_idle();
+        }
+
+    private:
+        std::unique_ptr<httplib::TaskQueue> inner;
+    };
+
+    AdmissionControl() {
+        configure(Options());
+    }
+
+    explicit AdmissionControl(const Options& options) {
+        configure(options);
+    }
+
+    // Apply options and reset both limits to maxConcurrency; call before serving requests
+    void configure(const Options& options) {
+        this->options = options;
+        this->options.maxConcurrency = std::max<size_t>(1, options.maxConcurrency);
+        this->options.minConcurrency = std::min(std::max<size_t>(1, options.minConcurrency),
+                                                this->options.maxConcurrency);
+        for (size_t c = 0; c < CLASS_COUNT; ++c) {
+            limiters[c].limit.store(this->options.maxConcurrency, std::memory_order_relaxed);
+            Metrics::setConcurrencyLimit(static_cast<Class>(c), this->options.maxConcurrency);
+        }
+    }
+
+    // Admit the request about to be handled on this thread; false if it was
+    // shed, with the 503 already in res. Every admitted request must be
+    // followed by finish() on the same thread.
+    bool admit(const httplib::Request& req, httplib::Response& res) {
+        Worker& worker = current();
+        release(worker);
+
+        // Only a connection's first request waited in the queue
+        uint64_t wait = worker.waitPending ? worker.queueWait : 0;
+        if (worker.waitPending) {
+            Metrics::recordQueueWait(wait);
+            worker.waitPending = false;
+        }
+        if (isExempt(req.path)) {
+            return true;
+        }
+
+        Class requestClass = classify(req.method);
+        Limiter& limiter = limiters[static_cast<size_t>(requestClass)];
+        if (options.queueDeadline != 0 && wait > options.queueDeadline) {
+            shed(res, requestClass, Metrics::ShedReason::Deadline);
+            return false;
+        }
+        size_t limit = limiter.limit.load(std::memory_order_relaxed);
+        size_t inFlight = limiter.inFlight.fetch_add(1, std::memory_order_acq_rel);
+        if (inFlight + 1 >= limit) {
+            limiter.saturated.store(true, std::memory_order_relaxed);
+        }
+        if (inFlight >= limit) {
+            limiter.inFlight.fetch_sub(1, std::memory_order_acq_rel);
+            shed(res, requestClass, Metrics::ShedReason::Limit);
+            return false;
+        }
+        worker.admitted = &limiter;
+        worker.admittedAt = Metrics::now();
+        return true;
+    }
+
+    // The request admitted on this thread is done, e.g. from the logger
+    void finish() {
+        Worker& worker = current();
+        Limiter* limiter = worker.admitted;
+        if (limiter == nullptr) {
+            return;
+        }
+        uint64_t now = Metrics::now();
+        release(worker);
+        if (options.adaptive) {
+            limiter->windowLatency.fetch_add(now - worker.admittedAt, std::memory_order_relaxed);
+            limiter->windowCount.fetch_add(1, std::memory_order_relaxed);
+            adjust(*limiter, static_cast<Class>(limiter - limiters), now);
+        }
+    }
+
+    size_t limit(Class requestClass) const {
+        return limiters[static_cast<size_t>(requestClass)].limit.load(std::memory_order_relaxed);
+    }
+
+    static Class classify(const std::string& method) {
+        return method == "GET" || method == "HEAD" ? Class::Read : Class::Write;
+    }
+
+    static bool isExempt(const std::string& path) {
+        return path == "/health" || path == "/metrics" || path == "/api/users/changes";
+    }
+
+private:
+    static constexpr size_t CLASS_COUNT = static_cast<size_t>(Class::COUNT);
+
+    struct alignas(64) Limiter {
+        std::atomic<size_t> inFlight{0};
+        std::atomic<size_t> limit{1};
+        std::atomic<uint64_t> windowStart{0};
+        std::atomic<uint64_t> windowLatency{0};  // Sum over the current window, nanoseconds
+        std::atomic<uint64_t> windowCount{0};
+        std::atomic<bool> saturated{false};      // In-flight reached the limit this window
+        double baseline = 0;  // Usual latency; only the thread closing a window touches it
+    };
+
+    // Per worker thread: the connection being served and the request holding a slot
+    struct Worker {
+        uint64_t queueWait = 0;       // Time the connection spent in the queue
+        bool waitPending = false;     // Its first request has not been admitted yet
+        Limiter* admitted = nullptr;
+        uint64_t admittedAt = 0;
+    };
+
+    Options options;
+    Limiter limiters[CLASS_COUNT];
+
+    static Worker& current() {
+        thread_local Worker worker;
+        return worker;
+    }
+
+    static void release(Worker& worker) {
+        if (worker.admitted != nullptr) {
+            worker.admitted->inFlight.fetch_sub(1, std::memory_order_acq_rel);
+            worker.admitted = nullptr;
+        }
+    }
+
+    // Close the window once it is WINDOW old and adjust the limit
+    void adjust(Limiter& limiter, Class requestClass, uint64_t now) {
+        uint64_t start = limiter.windowStart.load(std::memory_order_relaxed);
+        if (now - start < WINDOW ||
+            !limiter.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+            return;
+        }
+        uint64_t count = limiter.windowCount.exchange(0, std::memory_order_relaxed);
+        uint64_t total = limiter.windowLatency.exchange(0, std::memory_order_relaxed);
+        bool saturated = limiter.saturated.exchange(false, std::memory_order_relaxed);
+        if (count == 0) {
+            return;
+        }
+
+        double average = static_cast<double>(total) / static_cast<double>(count);
+        bool congested = saturated && limiter.baseline > 0 && average > 2 * limiter.baseline;
+        limiter.baseline = limiter.baseline > 0 ? limiter.baseline + (average - limiter.baseline) / 16 : average;
+
+        size_t limit = limiter.limit.load(std::memory_order_relaxed);
+        if (congested) {
+            limit = std::max(options.minConcurrency, limit * 3 / 4);
+        } else {
+            limit = std::min(options.maxConcurrency, limit + 1);
+        }
+        limiter.limit.store(limit, std::memory_order_relaxed);
+        Metrics::setConcurrencyLimit(requestClass, limit);
+    }
+
+    static void shed(httplib::Response& res, Class requestClass, Metrics::ShedReason reason) {
+        static const std::string body = [] {
+            std::string out;
+            Response::ApiResponse(false, "Server overloaded", nlohmann::json::object(), 503).writeJson(out);
+            return out;
+        }();
+
+        Metrics::recordShed(requestClass, reason);
+        res.status = 503;
+        res.set_header("Retry-After", "1");
+        res.set_header("Connection", "close");
+        res.set_content(body, "application/json");
+    }
+};
+
+#endif // ADMISSION_CONTROL_HPP
@@ -0,0 +1,130 @@
+#ifndef BINARY_WRITER_HPP
+#define BINARY_WRITER_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "WireFormat.hpp"
+
+// CBOR / MessagePack counterpart of JsonWriter: appends values straight into
+// an output buffer without building a nlohmann::json DOM.
+//
+// Output is byte-identical to nlohmann::json::to_cbor() / to_msgpack() of the
+// same document: integers and lengths use the shortest encoding, and callers
+// write map keys in the sorted order nlohmann uses. Unlike JSON, containers
+// are prefixed with their element count, so callers must know it up front.
+class BinaryWriter {
+public:
+    static void appendMapHeader(std::string& out, WireFormat::Format format, size_t size) {
+        if (format == WireFormat::Format::Cbor) {
+            appendCborHead(out, 0xA0, size);
+        } else {
+            appendMsgPackHead(out, 0x80, 0xDE, 0xDF, size);
+        }
+    }
+
+    static void appendArrayHeader(std::string& out, WireFormat::Format format, size_t size) {
+        if (format == WireFormat::Format::Cbor) {
+            appendCborHead(out, 0x80, size);
+        } else {
+            appendMsgPackHead(out, 0x90, 0xDC, 0xDD, size);
+        }
+    }
+
+    static void appendString(std::string& out, WireFormat::Format format, std::string_view value) {
+        appendStringHeader(out, format, value.size());
+        out += value;
+    }
+
+    // Map key; keys are plain strings in both formats
+    static void appendKey(std::string& out, WireFormat::Format format, const char* key) {
+        size_t length = std::char_traits<char>::length(key);
+        appendStringHeader(out, format, length);
+        out.append(key, length);
+    }
+
+    static void appendInt(std::string& out, WireFormat::Format format, long long value) {
+        if (format == WireFormat::Format::Cbor) {
+            if (value >= 0) {
+                appendCborHead(out, 0x00, static_cast<uint64_t>(value));
+            } else {
+                appendCborHead(out, 0x20, static_cast<uint64_t>(-1 - value));
+            }
+            return;
+        }
+
+        if (value >= 0) {
+            // Non-negative values use the unsigned encodings, as in nlohmann
+            uint64_t v = static_cast<uint64_t>(value);
+            if (v < 0x80) out += static_cast<char>(v);
+            else if (v <= UINT8_MAX) appendBigEndian(out, 0xCC, v, 1);
+            else if (v <= UINT16_MAX) appendBigEndian(out, 0xCD, v, 2);
+            else if (v <= UINT32_MAX) appendBigEndian(out, 0xCE, v, 4);
+            else appendBigEndian(out, 0xCF, v, 8);
+        } else {
+            uint64_t bits = static_cast<uint64_t>(value);
+            if (value >= -32) out += static_cast<char>(value);
+            else if (value >= INT8_MIN) appendBigEndian(out, 0xD0, bits, 1);
+            else if (value >= INT16_MIN) appendBigEndian(out, 0xD1, bits, 2);
+            else if (value >= INT32_MIN) appendBigEndian(out, 0xD2, bits, 4);
+            else appendBigEndian(out, 0xD3, bits, 8);
+        }
+    }
+
+    static void appendBool(std::string& out, WireFormat::Format format, bool value) {
+        if (format == WireFormat::Format::Cbor) {
+            out += static_cast<char>(value ? 0xF5 : 0xF4);
+        } else {
+            out += static_cast<char>(value ? 0xC3 : 0xC2);
+        }
+    }
+
+    // True if raw holds an encoded empty array or map
+    static bool isEmptyContainer(const std::string& raw, WireFormat::Format format) {
+        if (raw.size() != 1) {
+            return false;
+        }
+        unsigned char c = static_cast<unsigned char>(raw[0]);
+        return format == WireFormat::Format::Cbor ? (c == 0x80 || c == 0xA0) : (c == 0x90 || c == 0x80);
+    }
+
+private:
+    static void appendStringHeader(std::string& out, WireFormat::Format format, size_t length) {
+        if (format == WireFormat::Format::Cbor) {
+            appendCborHead(out, 0x60, length);
+        } else if (length <= 31) {
+            out += static_cast<char>(0xA0 | length);
+        } else if (length <= UINT8_MAX) {
+            appendBigEndian(out, 0xD9, length, 1);
+        } else {
+            appendMsgPackHead(out, 0, 0xDA, 0xDB, length);
+        }
+    }
+
+    // CBOR initial byte for major type (in the top three bits) and argument
+    static void appendCborHead(std::string& out, unsigned char major, uint64_t value) {
+        if (value <= 23) out += static_cast<char>(major | value);
+        else if (value <= UINT8_MAX) appendBigEndian(out, major | 24, value, 1);
+        else if (value <= UINT16_MAX) appendBigEndian(out, major | 25, value, 2);
+        else if (value <= UINT32_MAX) appendBigEndian(out, major | 26, value, 4);
+        else appendBigEndian(out, major | 27, value, 8);
+    }
+
+    // MessagePack container/string header: fix form for small sizes (when
+    // fixBase is non-zero), else the 16- or 32-bit length form
+    static void appendMsgPackHead(std::string& out, unsigned char fixBase, unsigned char marker16,
+                                  unsigned char marker32, uint64_t size) {
+        if (fixBase != 0 && size <= 15) out += static_cast<char>(fixBase | size);
+        else if (size <= UINT16_MAX) appendBigEndian(out, marker16, size, 2);
+        else appendBigEndian(out, marker32, size, 4);
+    }
+
+    static void appendBigEndian(std::string& out, unsigned char marker, uint64_t value, int bytes) {
+        out += static_cast<char>(marker);
+        for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+            out += static_cast<char>((value >> shift) & 0xFF);
+        }
+    }
+};
+
+#endif // BINARY_WRITER_HPP
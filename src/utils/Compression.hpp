@@ -0,0 +1,217 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "../../external/httplib.h"
+#include "Metrics.hpp"
+#include "QualityList.hpp"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Response compression: Accept-Encoding negotiation, a size threshold and
+// bodies that keep their compressed variants.
+//
+// gzip is available when built with HAVE_ZLIB and zstd with HAVE_ZSTD (CMake
+// defines them when zlib / libzstd are found); without them every response
+// goes out uncompressed. httplib's own compression stays disabled, so the
+// threshold here is the only thing deciding what gets compressed.
+class Compression {
+public:
+    enum class Encoding {
+        Identity,
+        Gzip,
+        Zstd,
+        COUNT
+    };
+
+    // Serialized body plus its compressed variants, each built on first use.
+    // Shared through the response cache, so an unchanged payload is
+    // compressed once per encoding rather than once per request.
+    class Body {
+    public:
+        explicit Body(std::string identity) : identity(std::move(identity)) {}
+
+        size_t size() const {
+            return identity.size();
+        }
+
+        // Bytes for encoding. Compresses on first use; when compression fails
+        // or does not shrink the body, encoding is set to Identity.
+        const std::string& get(Encoding& encoding) const {
+            if (encoding == Encoding::Identity) {
+                return identity;
+            }
+            Variant& variant = variants[static_cast<size_t>(encoding)];
+            std::call_once(variant.once, [this, encoding, &variant] {
+                variant.usable = compress(encoding, identity, variant.bytes) && variant.bytes.size() < identity.size();
+                if (!variant.usable) {
+                    std::string().swap(variant.bytes);
+                }
+            });
+            if (!variant.usable) {
+                encoding = Encoding::Identity;
+                return identity;
+            }
+            return variant.bytes;
+        }
+
+    private:
+        struct Variant {
+            std::once_flag once;
+            bool usable = false;
+            std::string bytes;
+        };
+
+        std::string identity;
+        mutable std::array<Variant, static_cast<size_t>(Encoding::COUNT)> variants;
+    };
+
+    // Bodies smaller than this are always sent uncompressed
+    static void setMinSize(size_t bytes) {
+        minimumSize.store(bytes, std::memory_order_relaxed);
+    }
+
+    // Preferred encoding the client accepts, by Accept-Encoding q-values;
+    // zstd wins ties over gzip. Identity if nothing usable is accepted.
+    static Encoding negotiate(const httplib::Request& req) {
+        auto found = req.headers.find("Accept-Encoding");
+        if (found == req.headers.end() || found->second.empty()) {
+            return Encoding::Identity;
+        }
+        std::string_view header = found->second;  // Parsed in place, without copies
+
+        double best = 0;
+        Encoding chosen = Encoding::Identity;
+        double wildcard = -1;
+        std::array<double, static_cast<size_t>(Encoding::COUNT)> quality{-1, -1, -1};
+
+        QualityList::forEach(header, [&](std::string_view token, double q) {
+            if (token == "gzip" || token == "x-gzip") quality[static_cast<size_t>(Encoding::Gzip)] = q;
+            else if (token == "zstd") quality[static_cast<size_t>(Encoding::Zstd)] = q;
+            else if (token == "*") wildcard = q;
+        });
+
+        for (Encoding encoding : {Encoding::Zstd, Encoding::Gzip}) {
+            if (!available(encoding)) {
+                continue;
+            }
+            double q = quality[static_cast<size_t>(encoding)];
+            if (q < 0) {
+                q = wildcard;
+            }
+            if (q > best) {
+                best = q;
+                chosen = encoding;
+            }
+        }
+        return chosen;
+    }
+
+    static bool available(Encoding encoding) {
+        switch (encoding) {
+            case Encoding::Identity: return true;
+#ifdef HAVE_ZLIB
+            case Encoding::Gzip: return true;
+#endif
+#ifdef HAVE_ZSTD
+            case Encoding::Zstd: return true;
+#endif
+            default: return false;
+        }
+    }
+
+    // Content-Encoding token, "" for identity; also used as the ETag variant
+    static const char* name(Encoding encoding) {
+        switch (encoding) {
+            case Encoding::Gzip: return "gzip";
+            case Encoding::Zstd: return "zstd";
+            default: return "";
+        }
+    }
+
+    // Send body in the negotiated encoding, or uncompressed when it is
+    // below the size threshold
+    static void send(httplib::Response& res, std::shared_ptr<const Body> body, Encoding encoding,
+                     const std::string& contentType) {
+        if (body->size() < minimumSize.load(std::memory_order_relaxed)) {
+            encoding = Encoding::Identity;
+        }
+        const std::string* bytes = &body->get(encoding);
+
+        res.set_header("Vary", "Accept-Encoding");
+        if (encoding != Encoding::Identity) {
+            res.set_header("Content-Encoding", name(encoding));
+        }
+        // Cached bytes are sent without a copy. The releaser owns the body,
+        // so it lives exactly as long as the response, on whichever thread
+        // that is destroyed; the provider only needs the bytes.
+        res.set_content_provider(bytes->size(), contentType,
+            [bytes](size_t offset, size_t length, httplib::DataSink& sink) {
+                return sink.write(bytes->data() + offset, length);
+            },
+            [body = std::move(body)](bool) {});
+    }
+
+private:
+    inline static std::atomic<size_t> minimumSize{1024};
+
+    static constexpr int GZIP_LEVEL = 6;
+    static constexpr int ZSTD_LEVEL = 3;
+
+    static bool compress(Encoding encoding, const std::string& input, std::string& output) {
+        uint64_t start = Metrics::threadCpuNow();
+        bool ok = false;
+        Metrics::Codec codec = Metrics::Codec::Gzip;
+
+        switch (encoding) {
+#ifdef HAVE_ZLIB
+            case Encoding::Gzip: {
+                z_stream stream{};
+                // windowBits 15 + 16 selects the gzip wrapper
+                if (deflateInit2(&stream, GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    return false;
+                }
+                output.resize(deflateBound(&stream, static_cast<uLong>(input.size())));
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+                stream.avail_in = static_cast<uInt>(input.size());
+                stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+                stream.avail_out = static_cast<uInt>(output.size());
+                ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+                output.resize(stream.total_out);
+                deflateEnd(&stream);
+                break;
+            }
+#endif
+#ifdef HAVE_ZSTD
+            case Encoding::Zstd: {
+                output.resize(ZSTD_compressBound(input.size()));
+                size_t written = ZSTD_compress(&output[0], output.size(), input.data(), input.size(), ZSTD_LEVEL);
+                ok = !ZSTD_isError(written);
+                output.resize(ok ? written : 0);
+                codec = Metrics::Codec::Zstd;
+                break;
+            }
+#endif
+            default:
+                return false;
+        }
+
+        if (ok) {
+            Metrics::recordCompression(codec, input.size(), output.size(), Metrics::threadCpuNow() - start);
+        }
+        return ok;
+    }
+};
+
+#endif // COMPRESSION_HPP
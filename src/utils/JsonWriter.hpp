@@ -0,0 +1,134 @@
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include "../../external/nlohmann/json.hpp"
+
+// Minimal JSON writer that appends straight into an output buffer.
+//
+// Used by the hot serialization paths (User, ApiResponse) to skip building a
+// nlohmann::json DOM. Output is byte-identical to nlohmann::json::dump() with
+// default settings: UTF-8 is passed through, control characters use the same
+// short escapes or lowercase \u00xx, and invalid UTF-8 raises the same
+// nlohmann::json::type_error.
+class JsonWriter {
+private:
+    // Length of the valid UTF-8 sequence starting at s[i], or 0 if invalid
+    static size_t utf8SequenceLength(std::string_view s, size_t i) {
+        auto byte = [&s](size_t k) { return static_cast<unsigned char>(s[k]); };
+        auto isCont = [&](size_t k) { return k < s.size() && (byte(k) & 0xC0) == 0x80; };
+
+        unsigned char c = byte(i);
+        if (c >= 0xC2 && c <= 0xDF) {
+            return isCont(i + 1) ? 2 : 0;
+        }
+        if (c >= 0xE0 && c <= 0xEF) {
+            if (!isCont(i + 1) || !isCont(i + 2)) return 0;
+            unsigned char c1 = byte(i + 1);
+            if (c == 0xE0 && c1 < 0xA0) return 0;  // Overlong
+            if (c == 0xED && c1 > 0x9F) return 0;  // UTF-16 surrogate
+            return 3;
+        }
+        if (c >= 0xF0 && c <= 0xF4) {
+            if (!isCont(i + 1) || !isCont(i + 2) || !isCont(i + 3)) return 0;
+            unsigned char c1 = byte(i + 1);
+            if (c == 0xF0 && c1 < 0x90) return 0;  // Overlong
+            if (c == 0xF4 && c1 > 0x8F) return 0;  // Above U+10FFFF
+            return 4;
+        }
+        return 0;
+    }
+
+    static bool isPlainAscii(unsigned char c) {
+        return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+    }
+
+public:
+    // True if value is valid UTF-8, i.e. appendString will not throw for it
+    static bool isValidUtf8(std::string_view value) {
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (static_cast<unsigned char>(value[i]) >= 0x80) {
+                size_t len = utf8SequenceLength(value, i);
+                if (len == 0) {
+                    return false;
+                }
+                i += len - 1;
+            }
+        }
+        return true;
+    }
+
+    // Append a quoted, escaped JSON string
+    static void appendString(std::string& out, std::string_view value) {
+        static const char hex[] = "0123456789abcdef";
+        size_t start = out.size();
+        out += '"';
+
+        for (size_t i = 0; i < value.size(); ++i) {
+            // Copy runs of plain ASCII in one append
+            size_t run = i;
+            while (run < value.size() && isPlainAscii(static_cast<unsigned char>(value[run]))) {
+                ++run;
+            }
+            if (run > i) {
+                out.append(value, i, run - i);
+                i = run;
+                if (i == value.size()) {
+                    break;
+                }
+            }
+
+            unsigned char c = static_cast<unsigned char>(value[i]);
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        out += "\\u00";
+                        out += hex[c >> 4];
+                        out += hex[c & 0xF];
+                    } else if (c < 0x80) {
+                        out += static_cast<char>(c);
+                    } else {
+                        size_t len = utf8SequenceLength(value, i);
+                        if (len == 0) {
+                            // Let nlohmann report the error exactly as dump() would
+                            out.resize(start);
+                            out += nlohmann::json(std::string(value)).dump();
+                            return;
+                        }
+                        out.append(value, i, len);
+                        i += len - 1;
+                    }
+            }
+        }
+
+        out += '"';
+    }
+
+    static void appendInt(std::string& out, long long value) {
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    static void appendBool(std::string& out, bool value) {
+        out += value ? "true" : "false";
+    }
+
+    // Append `"key":` for a key that needs no escaping
+    static void appendKey(std::string& out, const char* key) {
+        out += '"';
+        out += key;
+        out += "\":";
+    }
+};
+
+#endif // JSON_WRITER_HPP
@@ -3,10 +3,46 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <ctime>
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <cerrno>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// Minimum severity compiled into the binary: 0 = DEBUG, 1 = INFO,
+// 2 = WARNING, 3 = ERROR. Calls below it compile to nothing.
+#ifndef LOGGER_MIN_SEVERITY
+#define LOGGER_MIN_SEVERITY 0
+#endif
+
+// Logging utility.
+//
+// By default every record is written synchronously to stdout. After
+// startAsync(), producers format records straight into a bounded lock-free
+// MPSC ring buffer and a background thread drains it in batches with one
+// writev() per batch. If the ring is full the record is dropped and counted
+// rather than blocking the request thread.
+//
+// info()/warning()/error()/debug() take the message in parts (strings,
+// characters and integers) and join them in a per-thread buffer, only if
+// the level is enabled, so logging a request allocates nothing.
 class Logger {
 public:
     enum class Level {
@@ -17,19 +53,53 @@ public:
     };
 
 private:
-    static std::string getCurrentTimestamp() {
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()) % 1000;
-        
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-        ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-        return ss.str();
+    static constexpr size_t RECORD_SIZE = 1024;      // Bytes per ring slot, including the newline
+    static constexpr size_t DEFAULT_CAPACITY = 4096; // Slots; must be a power of two
+    static constexpr size_t WRITE_BATCH = 64;        // Records per writev()
+
+    // Bounded MPSC queue (Vyukov-style sequence numbers per slot)
+    struct Slot {
+        std::atomic<size_t> sequence;
+        uint32_t length;
+        char data[RECORD_SIZE];
+    };
+
+    struct AsyncState {
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> enqueuePos{0};
+        alignas(64) size_t dequeuePos = 0;  // Only touched by the writer thread
+
+        std::atomic<bool> running{true};
+        std::atomic<bool> writerSleeping{false};
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::thread writer;
+
+        explicit AsyncState(size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1) {
+            for (size_t i = 0; i < capacity; ++i) {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    inline static std::atomic<int> minSeverity{LOGGER_MIN_SEVERITY};
+    inline static std::atomic<uint64_t> dropped{0};
+    inline static std::atomic<AsyncState*> asyncState{nullptr};
+    inline static std::mutex asyncControlMutex;
+    inline static std::mutex syncOutputMutex;
+
+    static int severity(Level level) {
+        switch (level) {
+            case Level::DEBUG: return 0;
+            case Level::INFO: return 1;
+            case Level::WARNING: return 2;
+            case Level::ERROR: return 3;
+            default: return 3;
+        }
     }
 
-    static std::string levelToString(Level level) {
+    static const char* levelToString(Level level) {
         switch (level) {
             case Level::INFO: return "INFO";
             case Level::WARNING: return "WARN";
@@ -39,28 +109,319 @@ private:
         }
     }
 
+    // Writes "[YYYY-MM-DD HH:MM:SS.mmm] " (26 bytes) into out. The date/time
+    // part is formatted at most once per second per thread.
+    static size_t formatTimestamp(char* out) {
+        struct Cache {
+            std::time_t second = -1;
+            char text[20];
+        };
+        thread_local Cache cache;
+
+        auto now = std::chrono::system_clock::now();
+        auto time_t = std::chrono::system_clock::to_time_t(now);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now.time_since_epoch()).count() % 1000;
+
+        if (time_t != cache.second) {
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &time_t);
+#else
+            localtime_r(&time_t, &local);
+#endif
+            std::strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &local);
+            cache.second = time_t;
+        }
+
+        out[0] = '[';
+        std::memcpy(out + 1, cache.text, 19);
+        out[20] = '.';
+        out[21] = static_cast<char>('0' + ms / 100);
+        out[22] = static_cast<char>('0' + ms / 10 % 10);
+        out[23] = static_cast<char>('0' + ms % 10);
+        out[24] = ']';
+        out[25] = ' ';
+        return 26;
+    }
+
+    // Formats a full record, truncating the message to fit capacity bytes
+    static size_t formatRecord(char* out, size_t capacity, Level level, std::string_view message) {
+        size_t length = formatTimestamp(out);
+
+        const char* name = levelToString(level);
+        out[length++] = '[';
+        size_t nameLength = std::strlen(name);
+        std::memcpy(out + length, name, nameLength);
+        length += nameLength;
+        out[length++] = ']';
+        out[length++] = ' ';
+
+        size_t messageLength = std::min(message.size(), capacity - length - 1);
+        std::memcpy(out + length, message.data(), messageLength);
+        length += messageLength;
+        out[length++] = '\n';
+        return length;
+    }
+
+    static bool enqueue(AsyncState& state, Level level, std::string_view message) {
+        size_t pos = state.enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &state.slots[pos & state.mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (state.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = state.enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->length = static_cast<uint32_t>(formatRecord(slot->data, RECORD_SIZE, level, message));
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        if (state.writerSleeping.load(std::memory_order_relaxed)) {
+            state.wake.notify_one();
+        }
+        return true;
+    }
+
+    // Write a batch of ready slots starting at the consumer position
+    static void writeBatch(AsyncState& state, size_t count) {
+#ifndef _WIN32
+        struct iovec iov[WRITE_BATCH];
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = state.slots[(state.dequeuePos + i) & state.mask];
+            iov[i].iov_base = slot.data;
+            iov[i].iov_len = slot.length;
+        }
+
+        struct iovec* next = iov;
+        int remaining = static_cast<int>(count);
+        while (remaining > 0) {
+            ssize_t written = ::writev(STDOUT_FILENO, next, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;  // Nothing sensible to do if stdout is gone
+            }
+            while (remaining > 0 && static_cast<size_t>(written) >= next->iov_len) {
+                written -= static_cast<ssize_t>(next->iov_len);
+                ++next;
+                --remaining;
+            }
+            if (remaining > 0) {
+                next->iov_base = static_cast<char*>(next->iov_base) + written;
+                next->iov_len -= static_cast<size_t>(written);
+            }
+        }
+#else
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = state.slots[(state.dequeuePos + i) & state.mask];
+            std::fwrite(slot.data, 1, slot.length, stdout);
+        }
+        std::fflush(stdout);
+#endif
+
+        // Hand the slots back to producers
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = state.slots[(state.dequeuePos + i) & state.mask];
+            slot.sequence.store(state.dequeuePos + i + state.mask + 1, std::memory_order_release);
+        }
+        state.dequeuePos += count;
+    }
+
+    // Number of consecutive published slots at the consumer position
+    static size_t readyCount(AsyncState& state) {
+        size_t count = 0;
+        while (count < WRITE_BATCH) {
+            size_t pos = state.dequeuePos + count;
+            Slot& slot = state.slots[pos & state.mask];
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+            ++count;
+        }
+        return count;
+    }
+
+    static void writerLoop(AsyncState* state) {
+        for (;;) {
+            size_t count = readyCount(*state);
+            if (count > 0) {
+                writeBatch(*state, count);
+                continue;
+            }
+            if (!state->running.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(state->wakeMutex);
+            state->writerSleeping.store(true, std::memory_order_relaxed);
+            if (readyCount(*state) == 0 && state->running.load(std::memory_order_acquire)) {
+                // Timed wait bounds latency if a producer misses the flag
+                state->wake.wait_for(lock, std::chrono::milliseconds(10));
+            }
+            state->writerSleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    static void writeSync(Level level, std::string_view message) {
+        char stackBuffer[RECORD_SIZE];
+        std::string heapBuffer;
+        char* buffer = stackBuffer;
+        size_t capacity = sizeof(stackBuffer);
+        if (message.size() + 64 > capacity) {
+            heapBuffer.resize(message.size() + 64);
+            buffer = &heapBuffer[0];
+            capacity = heapBuffer.size();
+        }
+
+        size_t length = formatRecord(buffer, capacity, level, message);
+        std::lock_guard<std::mutex> lock(syncOutputMutex);
+        std::cout.write(buffer, static_cast<std::streamsize>(length));
+        std::cout.flush();
+    }
+
+    static void append(std::string& out, std::string_view part) {
+        out += part;
+    }
+
+    static void append(std::string& out, char part) {
+        out += part;
+    }
+
+    template <typename Int, typename = typename std::enable_if<std::is_integral<Int>::value>::type>
+    static void append(std::string& out, Int part) {
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), part).ptr;
+        out.append(digits, static_cast<size_t>(end - digits));
+    }
+
+    // Shared by every logParts() instantiation on this thread
+    static std::string& messageBuffer() {
+        thread_local std::string message;
+        return message;
+    }
+
+    template <typename... Parts>
+    static void logParts(Level level, const Parts&... parts) {
+        if (!enabled(level)) {
+            return;
+        }
+        std::string& message = messageBuffer();
+        message.clear();
+        (append(message, parts), ...);
+        log(level, message);
+    }
+
 public:
-    static void log(Level level, const std::string& message) {
-        std::cout << "[" << getCurrentTimestamp() << "] "
-                  << "[" << levelToString(level) << "] "
-                  << message << std::endl;
+    static void log(Level level, std::string_view message) {
+        if (!enabled(level)) {
+            return;
+        }
+
+        AsyncState* state = asyncState.load(std::memory_order_acquire);
+        if (state) {
+            if (!enqueue(*state, level, message)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        writeSync(level, message);
+    }
+
+    // True if a record at this level would be written; callers can use it to
+    // skip building expensive messages
+    static bool enabled(Level level) {
+        int s = severity(level);
+        return s >= LOGGER_MIN_SEVERITY && s >= minSeverity.load(std::memory_order_relaxed);
+    }
+
+    // Runtime level filter; records below it are discarded before formatting
+    static void setLevel(Level level) {
+        minSeverity.store(severity(level), std::memory_order_relaxed);
+    }
+
+    // Parse "debug", "info", "warn"/"warning" or "error"
+    static bool parseLevel(const std::string& name, Level& level) {
+        if (name == "debug") level = Level::DEBUG;
+        else if (name == "info") level = Level::INFO;
+        else if (name == "warn" || name == "warning") level = Level::WARNING;
+        else if (name == "error") level = Level::ERROR;
+        else return false;
+        return true;
+    }
+
+    // Records dropped because the async ring buffer was full
+    static uint64_t droppedRecords() {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    // Switch to asynchronous mode; capacity is rounded up to a power of two
+    static void startAsync(size_t capacity = DEFAULT_CAPACITY) {
+        std::lock_guard<std::mutex> lock(asyncControlMutex);
+        if (asyncState.load()) {
+            return;
+        }
+
+        size_t slots = 2;
+        while (slots < capacity) {
+            slots <<= 1;
+        }
+
+        std::cout.flush();
+        auto* state = new AsyncState(slots);
+        state->writer = std::thread(writerLoop, state);
+        asyncState.store(state, std::memory_order_release);
+
+        static bool registered = false;
+        if (!registered) {
+            registered = true;
+            std::atexit(stopAsync);
+        }
+    }
+
+    // Drain pending records and return to synchronous mode
+    static void stopAsync() {
+        std::lock_guard<std::mutex> lock(asyncControlMutex);
+        AsyncState* state = asyncState.exchange(nullptr, std::memory_order_acq_rel);
+        if (!state) {
+            return;
+        }
+
+        state->running.store(false, std::memory_order_release);
+        state->wake.notify_one();
+        state->writer.join();
+        // The state is intentionally leaked: a producer that loaded the
+        // pointer just before the exchange may still be writing a record
     }
 
-    static void info(const std::string& message) {
-        log(Level::INFO, message);
+    template <typename... Parts>
+    static void info(const Parts&... parts) {
+        if (LOGGER_MIN_SEVERITY <= 1) logParts(Level::INFO, parts...);
     }
 
-    static void warning(const std::string& message) {
-        log(Level::WARNING, message);
+    template <typename... Parts>
+    static void warning(const Parts&... parts) {
+        if (LOGGER_MIN_SEVERITY <= 2) logParts(Level::WARNING, parts...);
     }
 
-    static void error(const std::string& message) {
-        log(Level::ERROR, message);
+    template <typename... Parts>
+    static void error(const Parts&... parts) {
+        logParts(Level::ERROR, parts...);
     }
 
-    static void debug(const std::string& message) {
-        log(Level::DEBUG, message);
+    template <typename... Parts>
+    static void debug(const Parts&... parts) {
+        if (LOGGER_MIN_SEVERITY <= 0) logParts(Level::DEBUG, parts...);
     }
 };
 
-#endif // LOGGER_HPP
\ No newline at end of file
+#endif // LOGGER_HPP
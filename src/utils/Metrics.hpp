@@ -0,0 +1,566 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+// Process-wide metrics, exposed in Prometheus text format by /metrics.
+//
+// Counters and histograms are striped per thread: the first STRIPES - 1
+// threads that record anything each get a cache-line aligned stripe of their
+// own and update it with plain relaxed loads and stores (no locked
+// instructions); any further threads share the last stripe via fetch_add.
+// Reading sums the stripes; a scrape that races with writers may see a
+// sample in one bucket but not yet in the sum, which is fine for metrics.
+class Metrics {
+public:
+    static constexpr size_t STRIPES = 64;
+
+    // Monotonic clock in nanoseconds
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // CPU time consumed by the calling thread, in nanoseconds; falls back to
+    // now() where there is no per-thread CPU clock
+    static uint64_t threadCpuNow() {
+#if !defined(_WIN32) && defined(CLOCK_THREAD_CPUTIME_ID)
+        timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+        }
+#endif
+        return now();
+    }
+
+    class Counter {
+    private:
+        struct alignas(64) Cell {
+            std::atomic<uint64_t> value;
+        };
+        Cell cells[STRIPES];
+
+    public:
+        void add(uint64_t n = 1) {
+            size_t index = stripe();
+            increment(cells[index].value, n, index);
+        }
+
+        uint64_t value() const {
+            uint64_t total = 0;
+            for (const auto& cell : cells) {
+                total += cell.value.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+    };
+
+    // Log-linear (HDR-style) histogram of nanosecond values. Values below
+    // 2 * SUB_BUCKETS get an exact bucket; above that every power of two is
+    // split into SUB_BUCKETS equal buckets, so a bucket is never wider than
+    // 1/SUB_BUCKETS of its lower bound. Values from 2^MAX_BITS ns (~69 s)
+    // upwards land in the last bucket.
+    class Histogram {
+    public:
+        static constexpr int SUB_BUCKET_BITS = 4;
+        static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+        static constexpr int MAX_BITS = 36;
+        static constexpr size_t BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        struct Snapshot {
+            std::vector<uint64_t> counts;  // Per bucket
+            uint64_t count = 0;
+            uint64_t sum = 0;              // Nanoseconds
+
+            // Samples whose bucket lies entirely at or below limit
+            uint64_t countAtOrBelow(uint64_t limit) const {
+                uint64_t total = 0;
+                for (size_t i = 0; i < counts.size() && lowerBound(i + 1) <= limit + 1; ++i) {
+                    total += counts[i];
+                }
+                return total;
+            }
+
+            // Value at quantile q (0..1), reported as the middle of its bucket
+            uint64_t quantile(double q) const {
+                if (count == 0) {
+                    return 0;
+                }
+                uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count)));
+                if (rank == 0) {
+                    rank = 1;
+                }
+                uint64_t seen = 0;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    seen += counts[i];
+                    if (seen >= rank) {
+                        uint64_t low = lowerBound(i);
+                        return low + (lowerBound(i + 1) - low) / 2;
+                    }
+                }
+                return lowerBound(counts.size());
+            }
+        };
+
+        static size_t bucketIndex(uint64_t value) {
+            if (value < 2 * SUB_BUCKETS) {
+                return static_cast<size_t>(value);
+            }
+            if (value >> MAX_BITS) {
+                return BUCKETS - 1;
+            }
+            int shift = highestBit(value) - SUB_BUCKET_BITS;
+            return static_cast<size_t>(shift) * SUB_BUCKETS + static_cast<size_t>(value >> shift);
+        }
+
+        // Smallest value that maps to bucket index (index may be BUCKETS)
+        static uint64_t lowerBound(size_t index) {
+            if (index < 2 * SUB_BUCKETS) {
+                return index;
+            }
+            size_t shift = index / SUB_BUCKETS - 1;
+            return static_cast<uint64_t>(index - shift * SUB_BUCKETS) << shift;
+        }
+
+        void record(uint64_t nanoseconds) {
+            size_t index = stripe();
+            Stripe& s = stripes[index];
+            increment(s.counts[bucketIndex(nanoseconds)], 1, index);
+            increment(s.sum, nanoseconds, index);
+        }
+
+        Snapshot snapshot() const {
+            Snapshot result;
+            result.counts.assign(BUCKETS, 0);
+            for (const auto& s : stripes) {
+                for (size_t i = 0; i < BUCKETS; ++i) {
+                    uint64_t n = s.counts[i].load(std::memory_order_relaxed);
+                    result.counts[i] += n;
+                    result.count += n;
+                }
+                result.sum += s.sum.load(std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+    private:
+        struct alignas(64) Stripe {
+            std::atomic<uint64_t> counts[BUCKETS];
+            std::atomic<uint64_t> sum;
+        };
+        Stripe stripes[STRIPES];
+
+        static int highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+            return 63 - __builtin_clzll(value);
+#else
+            int bit = 0;
+            while (value >>= 1) {
+                ++bit;
+            }
+            return bit;
+#endif
+        }
+    };
+
+    // Records the time until the end of the enclosing scope
+    class ScopedTimer {
+    private:
+        Histogram& histogram;
+        uint64_t start;
+
+    public:
+        explicit ScopedTimer(Histogram& histogram) : histogram(histogram), start(now()) {}
+        ~ScopedTimer() { histogram.record(now() - start); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    };
+
+    // Routes with their own latency histogram
+    enum class Route {
+        ListUsers,
+        GetUser,
+        CreateUser,
+        BulkUsers,
+        UpdateUser,
+        DeleteUser,
+        Health,
+        MetricsEndpoint,
+        Other,
+        COUNT
+    };
+
+    enum class LockMode {
+        Read,
+        Write,
+        COUNT
+    };
+
+    // Outcome of a cacheable GET: served from the response cache, built and
+    // cached, or answered 304 from If-None-Match
+    enum class CacheResult {
+        Hit,
+        Miss,
+        NotModified,
+        COUNT
+    };
+
+    // Response body compression codecs
+    enum class Codec {
+        Gzip,
+        Zstd,
+        COUNT
+    };
+
+    // Request classes with their own admission limit
+    enum class RequestClass {
+        Read,
+        Write,
+        COUNT
+    };
+
+    // Why admission control turned a request away: it waited in the queue
+    // past the deadline, or its class was at its concurrency limit
+    enum class ShedReason {
+        Deadline,
+        Limit,
+        COUNT
+    };
+
+private:
+    static constexpr size_t ROUTE_COUNT = static_cast<size_t>(Route::COUNT);
+    static constexpr size_t STATUS_CLASSES = 5;  // 1xx .. 5xx
+
+    // Exported cumulative bucket bounds; each is filled from the fine buckets
+    // that lie entirely below it
+    struct Bound {
+        uint64_t nanoseconds;
+        const char* label;
+    };
+    static constexpr Bound BOUNDS[] = {
+        {1000, "0.000001"}, {2500, "0.0000025"}, {5000, "0.000005"},
+        {10000, "0.00001"}, {25000, "0.000025"}, {50000, "0.00005"},
+        {100000, "0.0001"}, {250000, "0.00025"}, {500000, "0.0005"},
+        {1000000, "0.001"}, {2500000, "0.0025"}, {5000000, "0.005"},
+        {10000000, "0.01"}, {25000000, "0.025"}, {50000000, "0.05"},
+        {100000000, "0.1"}, {250000000, "0.25"}, {500000000, "0.5"},
+        {1000000000, "1"}, {2500000000ULL, "2.5"}, {5000000000ULL, "5"},
+        {10000000000ULL, "10"}
+    };
+    static constexpr double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+    inline static std::atomic<size_t> nextStripe{0};
+    inline static Histogram requestLatency[ROUTE_COUNT];
+    inline static Counter requestCount[ROUTE_COUNT][STATUS_CLASSES];
+    inline static Histogram lockWaits[static_cast<size_t>(LockMode::COUNT)];
+    inline static Histogram serializationTime;
+    inline static Counter cacheResults[static_cast<size_t>(CacheResult::COUNT)];
+
+    static constexpr size_t CODEC_COUNT = static_cast<size_t>(Codec::COUNT);
+    inline static Counter compressionInput[CODEC_COUNT];
+    inline static Counter compressionOutput[CODEC_COUNT];
+    inline static Histogram compressionCpu[CODEC_COUNT];
+
+    static constexpr size_t CLASS_COUNT = static_cast<size_t>(RequestClass::COUNT);
+    static constexpr size_t REASON_COUNT = static_cast<size_t>(ShedReason::COUNT);
+    inline static Histogram queueWaits;
+    inline static Counter shedRequests[CLASS_COUNT][REASON_COUNT];
+    inline static std::atomic<uint64_t> concurrencyLimits[CLASS_COUNT] = {};
+
+    static constexpr size_t SHARED_STRIPE = STRIPES - 1;
+
+    static size_t stripe() {
+        thread_local size_t index = std::min(nextStripe.fetch_add(1, std::memory_order_relaxed), SHARED_STRIPE);
+        return index;
+    }
+
+    // Single-writer stripes skip the atomic read-modify-write
+    static void increment(std::atomic<uint64_t>& cell, uint64_t n, size_t index) {
+        if (index != SHARED_STRIPE) {
+            cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        } else {
+            cell.fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    // Start time of the request being handled on this thread, 0 if none
+    static uint64_t& requestStart() {
+        thread_local uint64_t start = 0;
+        return start;
+    }
+
+    static const char* routeLabel(Route route) {
+        switch (route) {
+            case Route::ListUsers: return "GET /api/users";
+            case Route::GetUser: return "GET /api/users/:id";
+            case Route::CreateUser: return "POST /api/users";
+            case Route::BulkUsers: return "POST /api/users/_bulk";
+            case Route::UpdateUser: return "PUT /api/users/:id";
+            case Route::DeleteUser: return "DELETE /api/users/:id";
+            case Route::Health: return "GET /health";
+            case Route::MetricsEndpoint: return "GET /metrics";
+            default: return "other";
+        }
+    }
+
+    static void appendSeconds(std::string& out, uint64_t nanoseconds) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9f", static_cast<double>(nanoseconds) / 1e9);
+        out += buffer;
+    }
+
+    static void appendHeader(std::string& out, const char* name, const char* type, const char* help) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    // _bucket/_sum/_count series of one histogram; labels is `name="value"`
+    // pairs or empty
+    static void appendHistogram(std::string& out, const char* name, const std::string& labels,
+                                const Histogram::Snapshot& data) {
+        std::string bucketLabels = labels.empty() ? "{le=\"" : "{" + labels + ",le=\"";
+        std::string otherLabels = labels.empty() ? "" : "{" + labels + "}";
+
+        for (const auto& bound : BOUNDS) {
+            out += name;
+            out += "_bucket" + bucketLabels + bound.label + "\"} ";
+            out += std::to_string(data.countAtOrBelow(bound.nanoseconds)) + '\n';
+        }
+        out += name;
+        out += "_bucket" + bucketLabels + "+Inf\"} " + std::to_string(data.count) + '\n';
+        out += name;
+        out += "_sum" + otherLabels + ' ';
+        appendSeconds(out, data.sum);
+        out += '\n';
+        out += name;
+        out += "_count" + otherLabels + ' ' + std::to_string(data.count) + '\n';
+    }
+
+    static void appendQuantiles(std::string& out, const char* name, const std::string& labels,
+                                const Histogram::Snapshot& data) {
+        for (double q : QUANTILES) {
+            char quantile[16];
+            std::snprintf(quantile, sizeof(quantile), "%g", q);
+            out += name;
+            out += '{' + labels + ",quantile=\"" + quantile + "\"} ";
+            if (data.count == 0) {
+                out += "NaN";
+            } else {
+                appendSeconds(out, data.quantile(q));
+            }
+            out += '\n';
+        }
+    }
+
+public:
+    static Route classify(const std::string& method, const std::string& path) {
+        static const std::string users = "/api/users";
+
+        if (path.compare(0, users.size(), users) == 0) {
+            if (path.size() == users.size()) {
+                if (method == "GET") return Route::ListUsers;
+                if (method == "POST") return Route::CreateUser;
+                return Route::Other;
+            }
+            if (path[users.size()] != '/') {
+                return Route::Other;
+            }
+
+            size_t start = users.size() + 1;
+            if (path.compare(start, std::string::npos, "_bulk") == 0) {
+                return method == "POST" ? Route::BulkUsers : Route::Other;
+            }
+            if (start == path.size() || path.find_first_not_of("0123456789", start) != std::string::npos) {
+                return Route::Other;
+            }
+            if (method == "GET") return Route::GetUser;
+            if (method == "PUT") return Route::UpdateUser;
+            if (method == "DELETE") return Route::DeleteUser;
+            return Route::Other;
+        }
+
+        if (method == "GET" && path == "/health") return Route::Health;
+        if (method == "GET" && path == "/metrics") return Route::MetricsEndpoint;
+        return Route::Other;
+    }
+
+    // Mark the start of a request on the calling thread
+    static void beginRequest() {
+        requestStart() = now();
+    }
+
+    // Record the request started by beginRequest() on this thread, if any
+    static void endRequest(const std::string& method, const std::string& path, int status) {
+        uint64_t& start = requestStart();
+        if (start == 0) {
+            return;
+        }
+        uint64_t elapsed = now() - start;
+        start = 0;
+
+        size_t route = static_cast<size_t>(classify(method, path));
+        requestLatency[route].record(elapsed);
+        if (status >= 100 && status < 600) {
+            requestCount[route][status / 100 - 1].add();
+        }
+    }
+
+    static void recordLockWait(LockMode mode, uint64_t nanoseconds) {
+        lockWaits[static_cast<size_t>(mode)].record(nanoseconds);
+    }
+
+    static void recordCache(CacheResult result) {
+        cacheResults[static_cast<size_t>(result)].add();
+    }
+
+    static void recordCompression(Codec codec, size_t inputBytes, size_t outputBytes, uint64_t cpuNanoseconds) {
+        size_t index = static_cast<size_t>(codec);
+        compressionInput[index].add(inputBytes);
+        compressionOutput[index].add(outputBytes);
+        compressionCpu[index].record(cpuNanoseconds);
+    }
+
+    static void recordQueueWait(uint64_t nanoseconds) {
+        queueWaits.record(nanoseconds);
+    }
+
+    static void recordShed(RequestClass requestClass, ShedReason reason) {
+        shedRequests[static_cast<size_t>(requestClass)][static_cast<size_t>(reason)].add();
+    }
+
+    static void setConcurrencyLimit(RequestClass requestClass, size_t limit) {
+        concurrencyLimits[static_cast<size_t>(requestClass)].store(limit, std::memory_order_relaxed);
+    }
+
+    static Histogram& serialization() {
+        return serializationTime;
+    }
+
+    // All metrics in Prometheus text exposition format (version 0.0.4)
+    static std::string render() {
+        std::string out;
+        out.reserve(64 * 1024);
+
+        appendHeader(out, "http_requests_total", "counter", "Requests handled, by route and status class.");
+        for (size_t r = 0; r < ROUTE_COUNT; ++r) {
+            for (size_t c = 0; c < STATUS_CLASSES; ++c) {
+                uint64_t value = requestCount[r][c].value();
+                if (value == 0) {
+                    continue;
+                }
+                out += "http_requests_total{route=\"";
+                out += routeLabel(static_cast<Route>(r));
+                out += "\",code=\"" + std::to_string(c + 1) + "xx\"} " + std::to_string(value) + '\n';
+            }
+        }
+
+        std::vector<Histogram::Snapshot> routes;
+        routes.reserve(ROUTE_COUNT);
+        for (size_t r = 0; r < ROUTE_COUNT; ++r) {
+            routes.push_back(requestLatency[r].snapshot());
+        }
+
+        appendHeader(out, "http_request_duration_seconds", "histogram",
+                     "Time from routing a request to writing the last byte of its response.");
+        for (size_t r = 0; r < ROUTE_COUNT; ++r) {
+            std::string labels = std::string("route=\"") + routeLabel(static_cast<Route>(r)) + '"';
+            appendHistogram(out, "http_request_duration_seconds", labels, routes[r]);
+        }
+
+        appendHeader(out, "http_request_duration_quantile_seconds", "gauge",
+                     "Request latency quantiles since startup, within one histogram bucket (6.25%).");
+        for (size_t r = 0; r < ROUTE_COUNT; ++r) {
+            std::string labels = std::string("route=\"") + routeLabel(static_cast<Route>(r)) + '"';
+            appendQuantiles(out, "http_request_duration_quantile_seconds", labels, routes[r]);
+        }
+
+        appendHeader(out, "user_service_lock_wait_seconds", "histogram",
+                     "Time spent blocked on a UserService shard lock, for acquisitions that had to wait.");
+        appendHistogram(out, "user_service_lock_wait_seconds", "mode=\"read\"",
+                        lockWaits[static_cast<size_t>(LockMode::Read)].snapshot());
+        appendHistogram(out, "user_service_lock_wait_seconds", "mode=\"write\"",
+                        lockWaits[static_cast<size_t>(LockMode::Write)].snapshot());
+
+        appendHeader(out, "json_serialization_seconds", "histogram",
+                     "Time spent serializing JSON response bodies, per serialization call.");
+        appendHistogram(out, "json_serialization_seconds", "", serializationTime.snapshot());
+
+        appendHeader(out, "http_response_cache_total", "counter",
+                     "Cacheable GETs by outcome: cache hit, cache miss, or 304 Not Modified.");
+        const char* const cacheLabels[] = {"hit", "miss", "not_modified"};
+        for (size_t i = 0; i < static_cast<size_t>(CacheResult::COUNT); ++i) {
+            out += "http_response_cache_total{result=\"";
+            out += cacheLabels[i];
+            out += "\"} " + std::to_string(cacheResults[i].value()) + '\n';
+        }
+
+        const char* const codecLabels[] = {"encoding=\"gzip\"", "encoding=\"zstd\""};
+        appendHeader(out, "response_compression_input_bytes_total", "counter",
+                     "Response bytes passed to the compressor.");
+        for (size_t c = 0; c < CODEC_COUNT; ++c) {
+            out += std::string("response_compression_input_bytes_total{") + codecLabels[c] + "} " +
+                   std::to_string(compressionInput[c].value()) + '\n';
+        }
+        appendHeader(out, "response_compression_output_bytes_total", "counter",
+                     "Compressed response bytes produced.");
+        for (size_t c = 0; c < CODEC_COUNT; ++c) {
+            out += std::string("response_compression_output_bytes_total{") + codecLabels[c] + "} " +
+                   std::to_string(compressionOutput[c].value()) + '\n';
+        }
+        appendHeader(out, "response_compression_ratio", "gauge",
+                     "Compressed size over original size since startup.");
+        for (size_t c = 0; c < CODEC_COUNT; ++c) {
+            uint64_t input = compressionInput[c].value();
+            char ratio[32];
+            std::snprintf(ratio, sizeof(ratio), "%.4f", input == 0 ? 0.0 : static_cast<double>(compressionOutput[c].value()) / input);
+            out += std::string("response_compression_ratio{") + codecLabels[c] + "} " + ratio + '\n';
+        }
+        appendHeader(out, "response_compression_cpu_seconds", "histogram",
+                     "Thread CPU time spent compressing one response body.");
+        for (size_t c = 0; c < CODEC_COUNT; ++c) {
+            appendHistogram(out, "response_compression_cpu_seconds", codecLabels[c], compressionCpu[c].snapshot());
+        }
+
+        const char* const classLabels[] = {"read", "write"};
+        const char* const reasonLabels[] = {"deadline", "limit"};
+        appendHeader(out, "http_queue_wait_seconds", "histogram",
+                     "Time a connection waited for a worker thread, recorded at its first request.");
+        appendHistogram(out, "http_queue_wait_seconds", "", queueWaits.snapshot());
+        appendHeader(out, "http_requests_shed_total", "counter",
+                     "Requests answered 503 by admission control, by request class and reason.");
+        for (size_t c = 0; c < CLASS_COUNT; ++c) {
+            for (size_t r = 0; r < REASON_COUNT; ++r) {
+                out += std::string("http_requests_shed_total{class=\"") + classLabels[c] + "\",reason=\"" +
+                       reasonLabels[r] + "\"} " + std::to_string(shedRequests[c][r].value()) + '\n';
+            }
+        }
+        appendHeader(out, "http_admission_concurrency_limit", "gauge",
+                     "Current in-flight request limit per request class.");
+        for (size_t c = 0; c < CLASS_COUNT; ++c) {
+            out += std::string("http_admission_concurrency_limit{class=\"") + classLabels[c] + "\"} " +
+                   std::to_string(concurrencyLimits[c].load(std::memory_order_relaxed)) + '\n';
+        }
+
+        return out;
+    }
+};
+
+#endif // METRICS_HPP
@@ -0,0 +1,52 @@
+#ifndef QUALITY_LIST_HPP
+#define QUALITY_LIST_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+
+// Comma-separated header values with q-values, e.g. Accept and
+// Accept-Encoding (RFC 9110 section 12.4.2). Parsed in place, without
+// copying the header.
+class QualityList {
+public:
+    // Call fn(token, q) for each non-empty item of value, in order. The
+    // token is trimmed and stripped of parameters; q is 1 unless given.
+    template <typename Fn>
+    static void forEach(std::string_view value, Fn&& fn) {
+        size_t start = 0;
+        while (start < value.size()) {
+            size_t end = value.find(',', start);
+            if (end == std::string_view::npos) {
+                end = value.size();
+            }
+            std::string_view item = value.substr(start, end - start);
+            start = end + 1;
+
+            double q = 1;
+            size_t semicolon = item.find(';');
+            if (semicolon != std::string_view::npos) {
+                size_t eq = item.find("q=", semicolon);
+                if (eq != std::string_view::npos) {
+                    q = parseQ(item.substr(eq + 2));
+                }
+                item = item.substr(0, semicolon);
+            }
+            size_t first = item.find_first_not_of(" \t");
+            if (first == std::string_view::npos) {
+                continue;
+            }
+            size_t last = item.find_last_not_of(" \t");
+            fn(item.substr(first, last - first + 1), q);
+        }
+    }
+
+    // q-value at the start of value, e.g. "0.8"; strtod needs a terminated copy
+    static double parseQ(std::string_view value) {
+        char digits[16] = {};
+        value.copy(digits, std::min(value.size(), sizeof(digits) - 1));
+        return std::strtod(digits, nullptr);
+    }
+};
+
+#endif // QUALITY_LIST_HPP
@@ -3,31 +3,131 @@
 
 #include <string>
 #include "../../external/nlohmann/json.hpp"
+#include "BinaryWriter.hpp"
+#include "JsonWriter.hpp"
+#include "WireFormat.hpp"
 
 class Response {
 public:
+    // Already-serialized "data" member in format, produced by a direct
+    // writer such as User::write
+    struct RawData {
+        std::string bytes;
+        WireFormat::Format format = WireFormat::Format::Json;
+    };
+
     struct ApiResponse {
         bool success;
         std::string message;
         nlohmann::json data;
         int statusCode;
+        std::string rawData;  // Used instead of data when non-empty
+        WireFormat::Format rawFormat = WireFormat::Format::Json;
 
         ApiResponse(bool success, const std::string& message, 
                    const nlohmann::json& data = nlohmann::json::object(), 
                    int statusCode = 200)
             : success(success), message(message), data(data), statusCode(statusCode) {}
 
+        ApiResponse(bool success, const std::string& message, RawData&& raw, int statusCode)
+            : success(success), message(message), data(nullptr), statusCode(statusCode),
+              rawData(std::move(raw.bytes)), rawFormat(raw.format) {}
+
+        // Append the envelope in format without building a DOM; byte-identical
+        // to toJson().dump(), to_cbor(toJson()) or to_msgpack(toJson())
+        void write(std::string& out, WireFormat::Format format) const {
+            out.reserve(out.size() + rawData.size() + message.size() + ENVELOPE_BYTES);
+            if (format == WireFormat::Format::Json) {
+                writeJson(out);
+                return;
+            }
+
+            bool raw = hasRawData();
+            bool hasData = raw || (!data.is_null() && !data.empty());
+            BinaryWriter::appendMapHeader(out, format, hasData ? 3 : 2);
+            if (hasData) {
+                BinaryWriter::appendKey(out, format, "data");
+                if (raw && rawFormat == format) {
+                    out += rawData;
+                } else {
+                    appendDom(out, raw ? decode(rawData, rawFormat) : data, format);
+                }
+            }
+            BinaryWriter::appendKey(out, format, "message");
+            BinaryWriter::appendString(out, format, message);
+            BinaryWriter::appendKey(out, format, "success");
+            BinaryWriter::appendBool(out, format, success);
+        }
+
+        // Append the envelope without building a DOM; byte-identical to toJson().dump()
+        void writeJson(std::string& out) const {
+            out += '{';
+            if (hasRawData()) {
+                JsonWriter::appendKey(out, "data");
+                if (rawFormat == WireFormat::Format::Json) {
+                    out += rawData;
+                } else {
+                    out += decode(rawData, rawFormat).dump();
+                }
+                out += ',';
+            } else if (!data.is_null() && !data.empty()) {
+                JsonWriter::appendKey(out, "data");
+                out += data.dump();
+                out += ',';
+            }
+            JsonWriter::appendKey(out, "message");
+            JsonWriter::appendString(out, message);
+            out += ',';
+            JsonWriter::appendKey(out, "success");
+            JsonWriter::appendBool(out, success);
+            out += '}';
+        }
+
         nlohmann::json toJson() const {
             nlohmann::json response;
             response["success"] = success;
             response["message"] = message;
             
-            if (!data.is_null() && !data.empty()) {
+            if (hasRawData()) {
+                response["data"] = decode(rawData, rawFormat);
+            } else if (!data.is_null() && !data.empty()) {
                 response["data"] = data;
             }
             
             return response;
         }
+
+    private:
+        // Room for the keys, punctuation and success flag around message and data
+        static constexpr size_t ENVELOPE_BYTES = 48;
+
+        // Empty objects and arrays are omitted, matching the DOM path
+        bool hasRawData() const {
+            if (rawData.empty()) {
+                return false;
+            }
+            if (rawFormat == WireFormat::Format::Json) {
+                return rawData != "{}" && rawData != "[]";
+            }
+            return !BinaryWriter::isEmptyContainer(rawData, rawFormat);
+        }
+
+        // Slow path for raw data in a format other than the one requested
+        static nlohmann::json decode(const std::string& raw, WireFormat::Format format) {
+            switch (format) {
+                case WireFormat::Format::Cbor: return nlohmann::json::from_cbor(raw);
+                case WireFormat::Format::MsgPack: return nlohmann::json::from_msgpack(raw);
+                default: return nlohmann::json::parse(raw);
+            }
+        }
+
+        static void appendDom(std::string& out, const nlohmann::json& value, WireFormat::Format format) {
+            switch (format) {
+                case WireFormat::Format::Cbor: nlohmann::json::to_cbor(value, out); break;
+                case WireFormat::Format::MsgPack: nlohmann::json::to_msgpack(value, out); break;
+                default: out += value.dump(); break;
+            }
+        }
     };
 
     // Success responses
@@ -39,26 +139,42 @@ public:
         return ApiResponse(true, message, data, 201);
     }
 
+    static ApiResponse success(const std::string& message, RawData data) {
+        return ApiResponse(true, message, std::move(data), 200);
+    }
+
+    static ApiResponse created(const std::string& message, RawData data) {
+        return ApiResponse(true, message, std::move(data), 201);
+    }
+
     // Error responses
     static ApiResponse badRequest(const std::string& message) {
-        return ApiResponse(false, message, nlohmann::json::object(), 400);
+        return ApiResponse(false, message, nullptr, 400);
     }
 
     static ApiResponse notFound(const std::string& message) {
-        return ApiResponse(false, message, nlohmann::json::object(), 404);
+        return ApiResponse(false, message, nullptr, 404);
+    }
+
+    static ApiResponse conflict(const std::string& message) {
+        return ApiResponse(false, message, nullptr, 409);
     }
 
     static ApiResponse internalError(const std::string& message) {
-        return ApiResponse(false, message, nlohmann::json::object(), 500);
+        return ApiResponse(false, message, nullptr, 500);
     }
 
     static ApiResponse methodNotAllowed(const std::string& message) {
-        return ApiResponse(false, message, nlohmann::json::object(), 405);
+        return ApiResponse(false, message, nullptr, 405);
+    }
+
+    static ApiResponse insufficientStorage(const std::string& message) {
+        return ApiResponse(false, message, nullptr, 507);
     }
 
     // Validation error
     static ApiResponse validationError(const std::string& message) {
-        return ApiResponse(false, "Validation Error: " + message, nlohmann::json::object(), 422);
+        return ApiResponse(false, "Validation Error: " + message, nullptr, 422);
     }
 };
 
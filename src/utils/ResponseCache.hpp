@@ -0,0 +1,147 @@
+#ifndef RESPONSE_CACHE_HPP
+#define RESPONSE_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Serialized responses keyed by resource and the store version they were
+// built from.
+//
+// A lookup only hits when the versions are equal, and put() replaces the
+// resource's previous entry, so a stale response is never served and is
+// overwritten by the next miss. The map is split into shards, each with its
+// own shared_mutex. A full shard evicts an arbitrary entry: that is cheap,
+// and a miss only costs one serialization.
+template <typename Key, typename Value = std::string>
+class ResponseCache {
+public:
+    using Entry = std::shared_ptr<const Value>;
+
+    explicit ResponseCache(size_t capacity) : shardCapacity(capacity / SHARDS + 1) {}
+
+    // The cached value for key if it was built from version, else nullptr
+    Entry get(const Key& key, uint64_t version) const {
+        const Shard& shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end() || it->second.version != version) {
+            return nullptr;
+        }
+        return it->second.value;
+    }
+
+    void put(const Key& key, uint64_t version, Entry value) {
+        Shard& shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            // Never replace a newer entry built by a racing request
+            if (it->second.version <= version) {
+                it->second = Slot{version, std::move(value)};
+            }
+            return;
+        }
+        if (shard.entries.size() >= shardCapacity) {
+            shard.entries.erase(shard.entries.begin());
+        }
+        shard.entries.emplace(key, Slot{version, std::move(value)});
+    }
+
+    void erase(const Key& key) {
+        Shard& shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.entries.erase(key);
+    }
+
+private:
+    static constexpr size_t SHARDS = 16;
+
+    struct Slot {
+        uint64_t version;
+        Entry value;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<Key, Slot> entries;
+    };
+
+    std::array<Shard, SHARDS> shards;
+    size_t shardCapacity;
+
+    Shard& shardFor(const Key& key) {
+        return shards[std::hash<Key>{}(key) % SHARDS];
+    }
+
+    const Shard& shardFor(const Key& key) const {
+        return shards[std::hash<Key>{}(key) % SHARDS];
+    }
+};
+
+// Strong entity tags built from a resource name and a store version.
+//
+// Versions start over when the server restarts, so every tag also carries a
+// random epoch drawn at startup: tags handed out by an earlier run never
+// match. The epoch is initialized before main(), i.e. before --workers
+// forks, so all worker processes issue the same tags.
+class ETag {
+public:
+    // variant distinguishes representations of the same version, e.g. the
+    // content coding; empty for the plain one
+    static std::string make(const std::string& resource, uint64_t version, const char* variant = "") {
+        std::string out;
+        make(out, resource, version, variant);
+        return out;
+    }
+
+    // Same tag written into out, whose capacity is reused
+    static void make(std::string& out, std::string_view resource, uint64_t version, std::string_view variant) {
+        char buffer[128];
+        int length = std::snprintf(buffer, sizeof(buffer), "\"%016llx-%.*s-%llx%s%.*s\"",
+                                   static_cast<unsigned long long>(epoch), static_cast<int>(resource.size()),
+                                   resource.data(), static_cast<unsigned long long>(version),
+                                   variant.empty() ? "" : "-", static_cast<int>(variant.size()), variant.data());
+        out.assign(buffer, std::min(static_cast<size_t>(std::max(length, 0)), sizeof(buffer) - 1));
+    }
+
+    // If-None-Match evaluation: "*" or any listed tag matches. The comparison
+    // is weak, as RFC 9110 requires here, so a W/ prefix is ignored.
+    static bool matches(std::string_view ifNoneMatch, std::string_view etag) {
+        size_t start = 0;
+        while (start < ifNoneMatch.size()) {
+            size_t end = ifNoneMatch.find(',', start);
+            if (end == std::string_view::npos) {
+                end = ifNoneMatch.size();
+            }
+
+            size_t first = ifNoneMatch.find_first_not_of(" \t", start);
+            size_t last = ifNoneMatch.find_last_not_of(" \t", end - 1);
+            if (first < end && last != std::string_view::npos && last >= first) {
+                if (ifNoneMatch.compare(first, 2, "W/") == 0) {
+                    first += 2;
+                }
+                size_t length = last - first + 1;
+                if ((length == 1 && ifNoneMatch[first] == '*') ||
+                    ifNoneMatch.compare(first, length, etag) == 0) {
+                    return true;
+                }
+            }
+            start = end + 1;
+        }
+        return false;
+    }
+
+private:
+    inline static const uint64_t epoch = std::random_device{}() * 0x100000000ULL ^ std::random_device{}();
+};
+
+#endif // RESPONSE_CACHE_HPP
@@ -0,0 +1,229 @@
+#ifndef ROUTER_HPP
+#define ROUTER_HPP
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../../external/httplib.h"
+
+// Path-trie router, built once at startup.
+//
+// Patterns are split on '/'. A segment is either a literal or ":name", an
+// integer parameter matching a run of digits that fits in an int; it is
+// parsed once while matching and handed to the handler in Params. Matching
+// walks one trie level per path segment (literals before parameters) without
+// regexes or allocations, so its cost depends on the path depth rather than
+// on the number of routes.
+//
+// httplib reads request bodies after its pre-routing handler, so dispatch()
+// only serves requests without a body there. install() registers one
+// forwarding route per method and path depth, using httplib's regex-free
+// "/:param" matcher, which matches the trie again once the body is read.
+//
+// An optional filter runs before every matched handler, in both paths, so it
+// sees a request only once its body (if any) has been read.
+class Router {
+public:
+    static constexpr size_t MAX_PARAMS = 4;
+    static constexpr size_t MAX_DEPTH = 16;  // Segments per route
+
+    // Integer path parameters, in pattern order
+    struct Params {
+        std::array<int, MAX_PARAMS> values{};
+        size_t count = 0;
+
+        int operator[](size_t index) const { return values[index]; }
+    };
+
+    using Handler = std::function<void(const httplib::Request&, httplib::Response&, const Params&)>;
+
+    // Returns false to skip the handler, having filled in the response itself
+    using Filter = std::function<bool(const httplib::Request&, httplib::Response&)>;
+
+    // Register a route; throws std::invalid_argument on a malformed or duplicate route
+    void add(const std::string& method, const std::string& pattern, Handler handler) {
+        int index = methodIndex(method);
+        if (index < 0 || pattern.empty() || pattern[0] != '/') {
+            throw std::invalid_argument("Invalid route: " + method + " " + pattern);
+        }
+
+        Node* node = &root;
+        size_t params = 0;
+        size_t depth = 0;
+        std::string_view rest = pattern;
+        while (!rest.empty()) {
+            std::string_view segment = nextSegment(rest);
+            if (++depth > MAX_DEPTH) {
+                throw std::invalid_argument("Too many segments in route: " + pattern);
+            }
+            if (!segment.empty() && segment[0] == ':') {
+                if (++params > MAX_PARAMS) {
+                    throw std::invalid_argument("Too many parameters in route: " + pattern);
+                }
+                if (!node->param) {
+                    node->param.reset(new Node());
+                }
+                node = node->param.get();
+            } else {
+                node = &node->literalChild(segment);
+            }
+        }
+
+        if (node->handlers[index]) {
+            throw std::invalid_argument("Duplicate route: " + method + " " + pattern);
+        }
+        node->handlers[index] = std::move(handler);
+        depths[index] |= 1u << depth;
+    }
+
+    void setFilter(Filter filter) {
+        this->filter = std::move(filter);
+    }
+
+    // Handler for method and path, with its parameters in params; nullptr if none
+    const Handler* match(const std::string& method, const std::string& path, Params& params) const {
+        int index = methodIndex(method);
+        if (index < 0) {
+            return nullptr;
+        }
+        params.count = 0;
+        return find(root, path, static_cast<size_t>(index), params);
+    }
+
+    // For httplib's pre-routing handler: serve matched requests that carry no body
+    httplib::Server::HandlerResponse dispatch(const httplib::Request& req, httplib::Response& res) const {
+        if (httplib::detail::expect_content(req)) {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+        Params params;
+        const Handler* handler = match(req.method, req.path, params);
+        if (!handler) {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+        call(*handler, req, res, params);
+        return httplib::Server::HandlerResponse::Handled;
+    }
+
+    // Register the forwarding routes for requests with a body; call after the last add()
+    void install(httplib::Server& server) const {
+        for (size_t depth = 1; depth <= MAX_DEPTH; ++depth) {
+            std::string pattern;
+            for (size_t i = 1; i <= depth; ++i) {
+                pattern += "/:p" + std::to_string(i);
+            }
+            auto forward = [this](const httplib::Request& req, httplib::Response& res) {
+                Params params;
+                const Handler* handler = match(req.method, req.path, params);
+                if (handler) {
+                    call(*handler, req, res, params);
+                } else {
+                    res.status = httplib::StatusCode::NotFound_404;
+                }
+            };
+
+            unsigned bit = 1u << depth;
+            if (depths[METHOD_GET] & bit) server.Get(pattern, forward);
+            if (depths[METHOD_POST] & bit) server.Post(pattern, forward);
+            if (depths[METHOD_PUT] & bit) server.Put(pattern, forward);
+            if (depths[METHOD_DELETE] & bit) server.Delete(pattern, forward);
+            if (depths[METHOD_PATCH] & bit) server.Patch(pattern, forward);
+        }
+    }
+
+private:
+    enum Method { METHOD_GET, METHOD_POST, METHOD_PUT, METHOD_DELETE, METHOD_PATCH, METHOD_OPTIONS, METHOD_COUNT };
+
+    struct Node {
+        std::vector<std::pair<std::string, std::unique_ptr<Node>>> literals;  // Sorted by segment
+        std::unique_ptr<Node> param;
+        std::array<Handler, METHOD_COUNT> handlers;
+
+        const Node* findLiteral(std::string_view segment) const {
+            auto it = std::lower_bound(literals.begin(), literals.end(), segment,
+                [](const auto& entry, std::string_view key) { return std::string_view(entry.first) < key; });
+            return it != literals.end() && it->first == segment ? it->second.get() : nullptr;
+        }
+
+        Node& literalChild(std::string_view segment) {
+            auto it = std::lower_bound(literals.begin(), literals.end(), segment,
+                [](const auto& entry, std::string_view key) { return std::string_view(entry.first) < key; });
+            if (it == literals.end() || it->first != segment) {
+                it = literals.emplace(it, std::string(segment), std::unique_ptr<Node>(new Node()));
+            }
+            return *it->second;
+        }
+    };
+
+    Node root;
+    std::array<unsigned, METHOD_COUNT> depths{};  // Bit n set: a route with n segments exists
+    Filter filter;
+
+    void call(const Handler& handler, const httplib::Request& req, httplib::Response& res, const Params& params) const {
+        if (!filter || filter(req, res)) {
+            handler(req, res, params);
+        }
+    }
+
+    static int methodIndex(const std::string& method) {
+        if (method == "GET" || method == "HEAD") return METHOD_GET;
+        if (method == "POST") return METHOD_POST;
+        if (method == "PUT") return METHOD_PUT;
+        if (method == "DELETE") return METHOD_DELETE;
+        if (method == "PATCH") return METHOD_PATCH;
+        if (method == "OPTIONS") return METHOD_OPTIONS;
+        return -1;
+    }
+
+    // Remove "/segment" from the front of rest and return segment
+    static std::string_view nextSegment(std::string_view& rest) {
+        rest.remove_prefix(1);
+        size_t end = rest.find('/');
+        std::string_view segment = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view() : rest.substr(end);
+        return segment;
+    }
+
+    static bool parseParam(std::string_view segment, int& value) {
+        if (segment.empty() || segment[0] < '0' || segment[0] > '9') {
+            return false;
+        }
+        auto end = segment.data() + segment.size();
+        auto parsed = std::from_chars(segment.data(), end, value);
+        return parsed.ec == std::errc() && parsed.ptr == end;
+    }
+
+    const Handler* find(const Node& node, std::string_view rest, size_t method, Params& params) const {
+        if (rest.empty()) {
+            return node.handlers[method] ? &node.handlers[method] : nullptr;
+        }
+        if (rest[0] != '/') {
+            return nullptr;
+        }
+        std::string_view segment = nextSegment(rest);
+
+        if (const Node* child = node.findLiteral(segment)) {
+            if (const Handler* handler = find(*child, rest, method, params)) {
+                return handler;
+            }
+        }
+
+        int value = 0;
+        if (node.param && parseParam(segment, value)) {
+            params.values[params.count++] = value;
+            if (const Handler* handler = find(*node.param, rest, method, params)) {
+                return handler;
+            }
+            --params.count;
+        }
+        return nullptr;
+    }
+};
+
+#endif // ROUTER_HPP
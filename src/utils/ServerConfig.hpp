@@ -0,0 +1,241 @@
+#ifndef SERVER_CONFIG_HPP
+#define SERVER_CONFIG_HPP
+
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <charconv>
+#include "../../external/httplib.h"
+#include "../../external/nlohmann/json.hpp"
+
+// HTTP server tuning: worker pool, keep-alive, timeouts, payload limit,
+// socket options, admission control, the number of worker processes and
+// response compression.
+//
+// Settings are resolved in increasing order of precedence from the
+// built-in defaults, a JSON config file (--config=<path> or SERVER_CONFIG),
+// SERVER_* environment variables and --flag=value command line arguments.
+// Every setting has the same name in all three sources, e.g.
+//   config file  {"keepAliveMaxCount": 1000}
+//   environment  SERVER_KEEP_ALIVE_MAX_COUNT=1000
+//   command line --keep-alive-max-count=1000
+// Invalid names or values throw std::invalid_argument.
+struct ServerConfig {
+    int port = 8080;
+    size_t threads = CPPHTTPLIB_THREAD_POOL_COUNT;
+    size_t queueLimit = 0;                          // Pending connections; 0 = unbounded
+    int queueDeadlineMs = 1000;                     // Longest queue wait before a 503; 0 = never
+    bool adaptiveConcurrency = true;                // Lower in-flight limits when latency climbs
+    size_t concurrencyLimitMax = 0;                 // In-flight requests per class; 0 = 3/4 of threads
+    size_t concurrencyLimitMin = 0;                 // Floor of adaptive limits; 0 = half the maximum
+    size_t keepAliveMaxCount = CPPHTTPLIB_KEEPALIVE_MAX_COUNT;
+    int keepAliveTimeout = CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND;  // Seconds
+    int readTimeout = CPPHTTPLIB_SERVER_READ_TIMEOUT_SECOND;     // Seconds
+    int writeTimeout = CPPHTTPLIB_SERVER_WRITE_TIMEOUT_SECOND;   // Seconds
+    size_t payloadMaxLength = 64 * 1024 * 1024;     // Largest accepted body (bulk limit)
+    bool tcpNoDelay = true;
+    int listenBacklog = 128;
+    int workers = 1;                                // Processes; >1 forks and shares the store
+    size_t sharedCapacity = 1000000;                // Users the shared store can hold (workers > 1)
+    size_t compressionMinSize = 1024;               // Smallest response body worth compressing
+    size_t changeLogSize = 65536;                   // Newest changes kept for the change feed (all shards); 0 disables it
+
+    // Resolve the configuration for this process. A bare first argument is
+    // still accepted as the port.
+    static ServerConfig load(int argc, char* argv[]) {
+        ServerConfig config;
+
+        std::string file;
+        if (const char* env = std::getenv("SERVER_CONFIG")) {
+            file = env;
+        }
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 9, "--config=") == 0) {
+                file = arg.substr(9);
+            }
+        }
+        if (!file.empty()) {
+            config.loadFile(file);
+        }
+
+        for (const auto& setting : SETTINGS) {
+            if (const char* value = std::getenv(setting.env)) {
+                config.set(setting.key, value);
+            }
+        }
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i == 1 && arg.compare(0, 2, "--") != 0) {
+                config.set("port", arg);
+                continue;
+            }
+
+            size_t eq = arg.find('=');
+            if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+                throw std::invalid_argument("Unrecognized argument: " + arg);
+            }
+            std::string flag = arg.substr(2, eq - 2);
+            if (flag == "config") {
+                continue;
+            }
+            config.set(keyForFlag(flag), arg.substr(eq + 1));
+        }
+
+        if (config.minConcurrency() > config.maxConcurrency()) {
+            throw std::invalid_argument("concurrencyLimitMin must not exceed concurrencyLimitMax");
+        }
+        return config;
+    }
+
+    // Per-class admission limit, with the default resolved. Below threads,
+    // so a class can reach it while the pool still has workers to spare.
+    size_t maxConcurrency() const {
+        return concurrencyLimitMax != 0 ? concurrencyLimitMax : std::max<size_t>(1, threads * 3 / 4);
+    }
+
+    // Floor the adaptive limits never go below, with the default resolved
+    size_t minConcurrency() const {
+        return concurrencyLimitMin != 0 ? concurrencyLimitMin : std::max<size_t>(1, maxConcurrency() / 2);
+    }
+
+    // Effective settings, reported by /health
+    nlohmann::json toJson() const {
+        return {
+            {"port", port},
+            {"threads", threads},
+            {"queueLimit", queueLimit},
+            {"queueDeadlineMs", queueDeadlineMs},
+            {"adaptiveConcurrency", adaptiveConcurrency},
+            {"concurrencyLimitMax", maxConcurrency()},
+            {"concurrencyLimitMin", minConcurrency()},
+            {"keepAliveMaxCount", keepAliveMaxCount},
+            {"keepAliveTimeout", keepAliveTimeout},
+            {"readTimeout", readTimeout},
+            {"writeTimeout", writeTimeout},
+            {"payloadMaxLength", payloadMaxLength},
+            {"tcpNoDelay", tcpNoDelay},
+            {"listenBacklog", listenBacklog},
+            {"workers", workers},
+            {"sharedCapacity", sharedCapacity},
+            {"compressionMinSize", compressionMinSize},
+            {"changeLogSize", changeLogSize}
+        };
+    }
+
+    // Set one setting by its config file key
+    void set(const std::string& key, const std::string& value) {
+        if (key == "port") port = parseInt(key, value, 1, 65535);
+        else if (key == "threads") threads = parseSize(key, value, 1);
+        else if (key == "queueLimit") queueLimit = parseSize(key, value, 0);
+        else if (key == "queueDeadlineMs") queueDeadlineMs = parseInt(key, value, 0, 3600000);
+        else if (key == "adaptiveConcurrency") adaptiveConcurrency = parseBool(key, value);
+        else if (key == "concurrencyLimitMax") concurrencyLimitMax = parseSize(key, value, 0);
+        else if (key == "concurrencyLimitMin") concurrencyLimitMin = parseSize(key, value, 0);
+        else if (key == "keepAliveMaxCount") keepAliveMaxCount = parseSize(key, value, 1);
+        else if (key == "keepAliveTimeout") keepAliveTimeout = parseInt(key, value, 0, 3600);
+        else if (key == "readTimeout") readTimeout = parseInt(key, value, 1, 3600);
+        else if (key == "writeTimeout") writeTimeout = parseInt(key, value, 1, 3600);
+        else if (key == "payloadMaxLength") payloadMaxLength = parseSize(key, value, 1);
+        else if (key == "tcpNoDelay") tcpNoDelay = parseBool(key, value);
+        else if (key == "listenBacklog") listenBacklog = parseInt(key, value, 1, 65535);
+        else if (key == "workers") workers = parseInt(key, value, 1, 1024);
+        else if (key == "sharedCapacity") sharedCapacity = parseSize(key, value, 1);
+        else if (key == "compressionMinSize") compressionMinSize = parseSize(key, value, 0);
+        else if (key == "changeLogSize") changeLogSize = parseSize(key, value, 0);
+        else throw std::invalid_argument("Unknown server setting: " + key);
+    }
+
+private:
+    struct Setting {
+        const char* key;   // Config file key
+        const char* env;   // Environment variable
+        const char* flag;  // Command line flag, without the leading --
+    };
+
+    static constexpr Setting SETTINGS[] = {
+        {"port", "SERVER_PORT", "port"},
+        {"threads", "SERVER_THREADS", "threads"},
+        {"queueLimit", "SERVER_QUEUE_LIMIT", "queue-limit"},
+        {"queueDeadlineMs", "SERVER_QUEUE_DEADLINE_MS", "queue-deadline-ms"},
+        {"adaptiveConcurrency", "SERVER_ADAPTIVE_CONCURRENCY", "adaptive-concurrency"},
+        {"concurrencyLimitMax", "SERVER_CONCURRENCY_LIMIT_MAX", "concurrency-limit-max"},
+        {"concurrencyLimitMin", "SERVER_CONCURRENCY_LIMIT_MIN", "concurrency-limit-min"},
+        {"keepAliveMaxCount", "SERVER_KEEP_ALIVE_MAX_COUNT", "keep-alive-max-count"},
+        {"keepAliveTimeout", "SERVER_KEEP_ALIVE_TIMEOUT", "keep-alive-timeout"},
+        {"readTimeout", "SERVER_READ_TIMEOUT", "read-timeout"},
+        {"writeTimeout", "SERVER_WRITE_TIMEOUT", "write-timeout"},
+        {"payloadMaxLength", "SERVER_PAYLOAD_MAX_LENGTH", "payload-max-length"},
+        {"tcpNoDelay", "SERVER_TCP_NODELAY", "tcp-nodelay"},
+        {"listenBacklog", "SERVER_LISTEN_BACKLOG", "listen-backlog"},
+        {"workers", "SERVER_WORKERS", "workers"},
+        {"sharedCapacity", "SERVER_SHARED_CAPACITY", "shared-capacity"},
+        {"compressionMinSize", "SERVER_COMPRESSION_MIN_SIZE", "compression-min-size"},
+        {"changeLogSize", "SERVER_CHANGE_LOG_SIZE", "change-log-size"}
+    };
+
+    static std::string keyForFlag(const std::string& flag) {
+        for (const auto& setting : SETTINGS) {
+            if (flag == setting.flag) {
+                return setting.key;
+            }
+        }
+        throw std::invalid_argument("Unknown option: --" + flag);
+    }
+
+    void loadFile(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::invalid_argument("Cannot open config file: " + path);
+        }
+        std::stringstream contents;
+        contents << in.rdbuf();
+
+        nlohmann::json root = nlohmann::json::parse(contents.str(), nullptr, false);
+        if (!root.is_object()) {
+            throw std::invalid_argument("Config file is not a JSON object: " + path);
+        }
+        for (const auto& item : root.items()) {
+            const auto& value = item.value();
+            set(item.key(), value.is_string() ? value.get<std::string>() : value.dump());
+        }
+    }
+
+    static unsigned long long parseNumber(const std::string& key, const std::string& value) {
+        unsigned long long result = 0;
+        auto end = value.data() + value.size();
+        auto parsed = std::from_chars(value.data(), end, result);
+        if (value.empty() || parsed.ec != std::errc() || parsed.ptr != end) {
+            throw std::invalid_argument("Invalid value for " + key + ": " + value);
+        }
+        return result;
+    }
+
+    static int parseInt(const std::string& key, const std::string& value, int min, int max) {
+        unsigned long long result = parseNumber(key, value);
+        if (result < static_cast<unsigned long long>(min) || result > static_cast<unsigned long long>(max)) {
+            throw std::invalid_argument(key + " must be between " + std::to_string(min) + " and " + std::to_string(max));
+        }
+        return static_cast<int>(result);
+    }
+
+    static size_t parseSize(const std::string& key, const std::string& value, size_t min) {
+        unsigned long long result = parseNumber(key, value);
+        if (result < min) {
+            throw std::invalid_argument(key + " must be at least " + std::to_string(min));
+        }
+        return static_cast<size_t>(result);
+    }
+
+    static bool parseBool(const std::string& key, const std::string& value) {
+        if (value == "true" || value == "1" || value == "on") return true;
+        if (value == "false" || value == "0" || value == "off") return false;
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+    }
+};
+
+#endif // SERVER_CONFIG_HPP
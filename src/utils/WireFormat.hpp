@@ -0,0 +1,107 @@
+#ifndef WIRE_FORMAT_HPP
+#define WIRE_FORMAT_HPP
+
+#include <string>
+#include <string_view>
+#include "../../external/nlohmann/json.hpp"
+#include "QualityList.hpp"
+
+// Body formats of the /api/users endpoints: JSON, CBOR (RFC 8949) and
+// MessagePack. All three carry the same document; the binary formats are
+// chosen with Accept (responses) and Content-Type (request bodies).
+class WireFormat {
+public:
+    enum class Format {
+        Json,
+        Cbor,
+        MsgPack
+    };
+
+    // Response format for an Accept header value. The highest q-value wins,
+    // the type listed first on ties; anything else, including a missing
+    // header and wildcards, gets JSON.
+    static Format fromAccept(std::string_view accept) {
+        Format chosen = Format::Json;
+        double best = 0;
+        bool explicitChoice = false;
+
+        QualityList::forEach(accept, [&](std::string_view type, double q) {
+            Format format;
+            if (!fromMediaType(type, format) || q <= 0) {
+                return;
+            }
+            if (!explicitChoice || q > best) {
+                chosen = format;
+                best = q;
+                explicitChoice = true;
+            }
+        });
+        return chosen;
+    }
+
+    // Request body format for a Content-Type header value; JSON unless a
+    // binary format is named
+    static Format fromContentType(std::string_view contentType) {
+        Format format = Format::Json;
+        fromMediaType(contentType.substr(0, contentType.find(';')), format);
+        return format;
+    }
+
+    // Static strings, so handing one to httplib copies it without a temporary
+    static const std::string& contentType(Format format) {
+        static const std::string json = "application/json";
+        static const std::string cbor = "application/cbor";
+        static const std::string msgpack = "application/msgpack";
+        switch (format) {
+            case Format::Cbor: return cbor;
+            case Format::MsgPack: return msgpack;
+            default: return json;
+        }
+    }
+
+    // For error messages, e.g. "Invalid CBOR format"
+    static const char* name(Format format) {
+        switch (format) {
+            case Format::Cbor: return "CBOR";
+            case Format::MsgPack: return "MessagePack";
+            default: return "JSON";
+        }
+    }
+
+    // Short token used in cache keys and ETags; "" for JSON
+    static const char* tag(Format format) {
+        switch (format) {
+            case Format::Cbor: return "cbor";
+            case Format::MsgPack: return "msgpack";
+            default: return "";
+        }
+    }
+
+    // nlohmann input format, for sax_parse() on request bodies
+    static nlohmann::json::input_format_t inputFormat(Format format) {
+        switch (format) {
+            case Format::Cbor: return nlohmann::json::input_format_t::cbor;
+            case Format::MsgPack: return nlohmann::json::input_format_t::msgpack;
+            default: return nlohmann::json::input_format_t::json;
+        }
+    }
+
+private:
+    static bool fromMediaType(std::string_view value, Format& format) {
+        size_t first = value.find_first_not_of(" \t");
+        size_t last = value.find_last_not_of(" \t");
+        if (first == std::string_view::npos) {
+            return false;
+        }
+        std::string_view type = value.substr(first, last - first + 1);
+
+        if (type == "application/json") format = Format::Json;
+        else if (type == "application/cbor") format = Format::Cbor;
+        else if (type == "application/msgpack" || type == "application/x-msgpack" ||
+                 type == "application/vnd.msgpack") format = Format::MsgPack;
+        else return false;
+        return true;
+    }
+};
+
+#endif // WIRE_FORMAT_HPP
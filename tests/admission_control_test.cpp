@@ -0,0 +1,134 @@
+// AdmissionControl under simulated overload.
+//
+// Requests hold one of CORES simulated cores for WORK each, so latency grows
+// with the number in flight once they outnumber the cores. A light load
+// first sets the usual latency; a burst of many concurrent clients must then
+// drive the read limit down from its maximum towards its minimum and get
+// requests shed, and the limit must grow again once the load is light.
+//
+// Run by ctest; exits with status 1 on failure.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../external/httplib.h"
+#include "utils/AdmissionControl.hpp"
+
+namespace {
+
+constexpr size_t MAX_LIMIT = 16;
+constexpr size_t MIN_LIMIT = 4;
+constexpr int CORES = 2;
+constexpr auto WORK = std::chrono::milliseconds(1);
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+// CORES slots; holding one for WORK stands in for request processing
+class Cores {
+public:
+    void run() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [this] { return busy < CORES; });
+            ++busy;
+        }
+        std::this_thread::sleep_for(WORK);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busy;
+        }
+        released.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    int busy = 0;
+};
+
+struct Load {
+    std::atomic<size_t> served{0};
+    std::atomic<size_t> shed{0};
+};
+
+// Run `clients` closed-loop clients for `duration`; returns the lowest read
+// limit seen meanwhile
+size_t drive(AdmissionControl& admission, Cores& cores, Load& load, int clients,
+             std::chrono::milliseconds duration) {
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&] {
+            httplib::Request req;
+            req.method = "GET";
+            req.path = "/api/users";
+            while (!stop.load()) {
+                httplib::Response res;
+                if (!admission.admit(req, res)) {
+                    ++load.shed;
+                    std::this_thread::sleep_for(WORK);  // Back off like a client honouring Retry-After
+                    continue;
+                }
+                cores.run();
+                admission.finish();
+                ++load.served;
+            }
+        });
+    }
+
+    size_t lowest = admission.limit(AdmissionControl::Class::Read);
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        lowest = std::min(lowest, admission.limit(AdmissionControl::Class::Read));
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return lowest;
+}
+
+}  // namespace
+
+int main() {
+    AdmissionControl::Options options;
+    options.maxConcurrency = MAX_LIMIT;
+    options.minConcurrency = MIN_LIMIT;
+    AdmissionControl admission(options);
+    Cores cores;
+
+    Load light;
+    drive(admission, cores, light, CORES, std::chrono::milliseconds(1000));
+    check(light.shed == 0, "no request is shed under light load");
+    check(admission.limit(AdmissionControl::Class::Read) == MAX_LIMIT, "the limit stays at its maximum under light load");
+
+    Load overload;
+    size_t lowest = drive(admission, cores, overload, 64, std::chrono::milliseconds(2000));
+    std::fprintf(stderr, "overload: served %zu, shed %zu, lowest limit %zu\n", overload.served.load(),
+                 overload.shed.load(), lowest);
+    check(overload.shed > 0, "requests over the limit are shed");
+    check(lowest <= MAX_LIMIT / 2, "the limit shrinks under overload");
+    check(lowest >= MIN_LIMIT, "the limit never goes below its minimum");
+
+    Load recovery;
+    drive(admission, cores, recovery, CORES, std::chrono::milliseconds(1500));
+    size_t recovered = admission.limit(AdmissionControl::Class::Read);
+    std::fprintf(stderr, "recovery: limit %zu\n", recovered);
+    check(recovered > lowest + 4, "the limit grows again once the load is light");
+    check(admission.limit(AdmissionControl::Class::Write) == MAX_LIMIT, "the write limit is unaffected by reads");
+
+    return failures == 0 ? 0 : 1;
+}
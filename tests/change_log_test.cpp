@@ -0,0 +1,123 @@
+// ChangeLog retention when writes are spread unevenly over the shards.
+//
+// The log keeps one ring per store shard, but changeLogSize counts changes
+// across all of them: a reader up to changeLogSize changes behind must be
+// able to catch up however many of those changes went to one shard, and a
+// reader further behind must be told to resync rather than miss changes.
+//
+// Run by ctest; exits with status 1 on failure.
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "services/ChangeLog.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+User makeUser(int id) {
+    return User(id, "User " + std::to_string(id), "user" + std::to_string(id) + "@example.com", 30);
+}
+
+// Read everything after since in pages of limit; false on a resync
+bool readAll(const ChangeLog& log, uint64_t since, size_t limit, std::vector<ChangeLog::Change>& out) {
+    while (since < log.latest()) {
+        size_t before = out.size();
+        if (!log.read(since, limit, out) || out.size() == before) {
+            return false;
+        }
+        since = out.back().seq;
+    }
+    return true;
+}
+
+// Every change after since, in order and without gaps
+bool isComplete(const std::vector<ChangeLog::Change>& changes, uint64_t since, uint64_t newest) {
+    if (changes.size() != newest - since) {
+        return false;
+    }
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (changes[i].seq != since + 1 + i || changes[i].user.id != static_cast<int>(changes[i].seq % 1000000)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void append(ChangeLog& log, size_t shard) {
+    // The user id echoes the sequence number the change is about to get
+    User user = makeUser(static_cast<int>((log.latest() + 1) % 1000000));
+    log.append(shard, ChangeLog::Type::Update, user.view());
+}
+
+void testSkewedWrites() {
+    const size_t capacity = 4096;
+    const size_t shards = 32;
+    ChangeLog log(capacity, shards);
+
+    // Every write goes to shard 5, many times the log's size
+    for (size_t i = 0; i < capacity * 5; ++i) {
+        append(log, 5);
+    }
+    uint64_t newest = log.latest();
+    std::vector<ChangeLog::Change> changes;
+    check(readAll(log, newest - capacity, 1000, changes) && isComplete(changes, newest - capacity, newest),
+          "the newest changeLogSize changes to one shard are all readable");
+    changes.clear();
+    check(!log.read(newest - capacity - 1, 1000, changes) && changes.empty(),
+          "a reader further behind is told to resync");
+
+    // The hot shard moves; the old one's entries age out
+    for (size_t i = 0; i < capacity * 3; ++i) {
+        append(log, 9);
+    }
+    newest = log.latest();
+    changes.clear();
+    check(readAll(log, newest - capacity, 1000, changes) && isComplete(changes, newest - capacity, newest),
+          "after the hot shard moves, the newest changeLogSize changes are all readable");
+    changes.clear();
+    check(!log.read(newest - capacity - 1, 1000, changes), "after the hot shard moves, older readers resync");
+}
+
+void testRandomShards() {
+    const size_t capacity = 1000;
+    ChangeLog log(capacity, 8);
+    std::mt19937 rng(3);
+    uint64_t start = log.latest();
+    // Mostly one shard, the rest anywhere
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 700; ++i) {
+            append(log, rng() % 4 == 0 ? rng() % 8 : 2);
+        }
+        uint64_t newest = log.latest();
+        uint64_t since = std::max(start, newest - capacity);
+        std::vector<ChangeLog::Change> changes;
+        check(readAll(log, since, 97, changes) && isComplete(changes, since, newest),
+              "paging from the oldest kept change returns every change (round " + std::to_string(round) + ")");
+    }
+}
+
+void testDisabled() {
+    ChangeLog log(0, 4);
+    User user = makeUser(1);
+    check(!log.enabled() && log.append(0, ChangeLog::Type::Create, user.view()) == 0,
+          "a log of size 0 is disabled");
+}
+
+}  // namespace
+
+int main() {
+    testSkewedWrites();
+    testRandomShards();
+    testDisabled();
+    return failures == 0 ? 0 : 1;
+}
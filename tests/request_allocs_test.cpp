@@ -0,0 +1,206 @@
+// Heap allocations per request on the controller -> service -> response path.
+//
+// Replaces the global operator new with one that counts allocations made by
+// the calling thread, preloads users, then calls UserController handlers the
+// way the router does and reports the steady-state allocations of each
+// scenario (after a warm-up pass that fills caches and thread-local buffers).
+// httplib's own request parsing and response writing are not included, and
+// neither is the response header map: set_header() allocates a node and a
+// value string per header inside httplib. Those allocations are counted
+// separately by replaying the response's headers onto a fresh Response, and
+// subtracted, so the budget covers only the application's own allocations.
+//
+// Each scenario has a budget. Run by ctest; exits with status 1 if any
+// scenario goes over it.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+#include "../external/httplib.h"
+#include "controllers/UserController.hpp"
+#include "utils/Logger.hpp"
+
+namespace {
+
+thread_local size_t allocations = 0;
+
+void* allocate(size_t size) noexcept {
+    ++allocations;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* allocateAligned(size_t size, std::align_val_t alignment) noexcept {
+    ++allocations;
+    size_t align = static_cast<size_t>(alignment);
+    // aligned_alloc wants a size that is a multiple of the alignment
+    return std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+}
+
+// Out of line, so that GCC does not inline a delete into its caller and
+// then warn that the pointer from operator new reaches free()
+[[gnu::noinline]] void release(void* p) noexcept {
+    std::free(p);
+}
+
+void* orThrow(void* p) {
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+}  // namespace
+
+// The whole replaceable family, so every form of new is counted and every
+// delete matches the allocation function that produced its pointer
+
+void* operator new(size_t size) { return orThrow(allocate(size)); }
+void* operator new[](size_t size) { return orThrow(allocate(size)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(size_t size, std::align_val_t align) { return orThrow(allocateAligned(size, align)); }
+void* operator new[](size_t size, std::align_val_t align) { return orThrow(allocateAligned(size, align)); }
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, align);
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, align);
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+
+namespace {
+
+constexpr int USERS = 10000;
+constexpr int WARMUP = 1000;
+constexpr int ITERATIONS = 10000;
+
+struct Scenario {
+    const char* name;
+    size_t budget;  // Allocations per request
+    std::function<void(httplib::Request&, int)> prepare;  // Set up request i (not counted)
+    std::function<void(const httplib::Request&, httplib::Response&, int)> handle;
+};
+
+httplib::Request makeRequest(const char* method, const std::string& path) {
+    httplib::Request req;
+    req.method = method;
+    req.path = path;
+    return req;
+}
+
+// Allocations httplib makes to store res's headers
+size_t headerAllocations(const httplib::Response& res) {
+    httplib::Response replay;
+    size_t before = allocations;
+    for (const auto& header : res.headers) {
+        replay.set_header(header.first, header.second);
+    }
+    return allocations - before;
+}
+
+// Application allocations per request while running scenario, after warming it up
+double measure(const Scenario& scenario) {
+    size_t total = 0;
+    for (int i = 0; i < WARMUP + ITERATIONS; ++i) {
+        httplib::Request req = makeRequest("GET", "/");
+        scenario.prepare(req, i);
+        httplib::Response res;
+
+        size_t before = allocations;
+        scenario.handle(req, res, i);
+        size_t used = allocations - before;
+        size_t headers = headerAllocations(res);
+        used = used > headers ? used - headers : 0;
+        if (i >= WARMUP) {
+            total += used;
+        }
+    }
+    return static_cast<double>(total) / ITERATIONS;
+}
+
+}  // namespace
+
+int main() {
+    // Keep logging on, as in production, but out of the terminal
+    if (!std::freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+    Logger::setLevel(Logger::Level::INFO);
+
+    UserController controller;
+    UserService& service = controller.getUserService();
+    for (int i = 1; i <= USERS; ++i) {
+        User created;
+        service.createUser(User(0, "User " + std::to_string(i), "user" + std::to_string(i) + "@example.com", 20 + i % 50),
+                           created);
+    }
+
+    auto byId = [](const char* accept) {
+        return [accept](httplib::Request& req, int i) {
+            int id = 1 + i % 100;
+            req.path = "/api/users/" + std::to_string(id);
+            if (accept) {
+                req.set_header("Accept", accept);
+            }
+        };
+    };
+    auto getUser = [&controller](const httplib::Request& req, httplib::Response& res, int i) {
+        controller.getUserById(req, res, 1 + i % 100);
+    };
+
+    std::vector<Scenario> scenarios = {
+        // Cached responses: the std::function releaser that keeps the shared body alive
+        {"GET /api/users/:id (JSON)", 1, byId(nullptr), getUser},
+        {"GET /api/users/:id (CBOR)", 1, byId("application/cbor"), getUser},
+        {"GET /api/users/:id (If-None-Match)", 0,
+         [&controller](httplib::Request& req, int i) {
+             int id = 1 + i % 100;
+             req.path = "/api/users/" + std::to_string(id);
+             httplib::Response first;
+             controller.getUserById(req, first, id);
+             req.set_header("If-None-Match", first.get_header_value("ETag"));
+         },
+         getUser},
+        // The error body itself, which is moved into the response
+        {"GET /api/users/:id (not found)", 1,
+         [](httplib::Request& req, int) { req.path = "/api/users/999999"; },
+         [&controller](const httplib::Request& req, httplib::Response& res, int) {
+             controller.getUserById(req, res, 999999);
+         }},
+        {"GET /api/users?limit=100", 1,
+         [](httplib::Request& req, int) {
+             req.path = "/api/users";
+             req.params.emplace("limit", "100");
+         },
+         [&controller](const httplib::Request& req, httplib::Response& res, int) {
+             controller.getAllUsers(req, res);
+         }},
+    };
+
+    bool ok = true;
+    std::fprintf(stderr, "%-40s %12s %8s\n", "Scenario", "allocs/req", "budget");
+    for (const auto& scenario : scenarios) {
+        double perRequest = measure(scenario);
+        bool within = perRequest <= static_cast<double>(scenario.budget);
+        ok = ok && within;
+        std::fprintf(stderr, "%-40s %12.2f %8zu%s\n", scenario.name, perRequest, scenario.budget,
+                     within ? "" : "  OVER BUDGET");
+    }
+    return ok ? 0 : 1;
+}
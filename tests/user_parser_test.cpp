@@ -0,0 +1,102 @@
+// UserParser and BulkParser on CBOR and MessagePack bodies with invalid UTF-8.
+//
+// nlohmann's binary readers do not check that strings are UTF-8, unlike its
+// JSON lexer. A user stored with an invalid name would make every later JSON
+// response for it throw, so the parsers must reject such bodies the same
+// way they reject invalid JSON.
+//
+// Run by ctest; exits with status 1 on failure.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "models/BulkOperation.hpp"
+#include "models/UserParser.hpp"
+
+namespace {
+
+using Format = WireFormat::Format;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+std::string encode(const nlohmann::json& value, Format format) {
+    std::vector<uint8_t> bytes = format == Format::Cbor ? nlohmann::json::to_cbor(value)
+                                                        : nlohmann::json::to_msgpack(value);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+// Encode value, then overwrite the bytes of marker (which must be in a
+// string value) with replacement, which has the same length
+std::string encodeWith(const nlohmann::json& value, Format format, const std::string& marker,
+                       const std::string& replacement) {
+    std::string body = encode(value, format);
+    body.replace(body.find(marker), marker.size(), replacement);
+    return body;
+}
+
+nlohmann::json userJson(const std::string& name) {
+    return {{"name", name}, {"email", "ann@example.com"}, {"age", 30}};
+}
+
+void checkFormat(Format format) {
+    std::string label = std::string(WireFormat::name(format)) + ": ";
+
+    User user;
+    check(UserParser::parse(encode(userJson("Zoë 日本"), format), user, format) == UserParser::Result::Ok &&
+              user.name == "Zoë 日本",
+          label + "valid multi-byte UTF-8 is accepted");
+
+    // A lone 0xFF, a truncated sequence, a UTF-16 surrogate and an overlong
+    // encoding of '/', each written over X placeholders in the name
+    const std::string invalid[] = {"\xFF", "\xC3", "\xED\xA0\x80", "\xC0\xAF"};
+    for (const std::string& bytes : invalid) {
+        std::string marker(bytes.size(), 'X');
+        User rejected;
+        std::string body = encodeWith(userJson("Ann" + marker), format, marker, bytes);
+        check(UserParser::parse(body, rejected, format) == UserParser::Result::SyntaxError,
+              label + "a name that is not UTF-8 is rejected as malformed");
+    }
+
+    User rejected;
+    nlohmann::json badEmail = {{"name", "Ann"}, {"email", "XX@example.com"}, {"age", 30}};
+    check(UserParser::parse(encodeWith(badEmail, format, "XX", "\xC3\x28"), rejected, format) ==
+              UserParser::Result::SyntaxError,
+          label + "an email that is not UTF-8 is rejected as malformed");
+
+    nlohmann::json ops = nlohmann::json::array({
+        {{"op", "create"}, {"name", "Ann"}, {"email", "ann@example.com"}, {"age", 30}},
+        {{"op", "create"}, {"name", "BobX"}, {"email", "bob@example.com"}, {"age", 40}},
+    });
+    std::vector<BulkOperation> parsed;
+    size_t errorIndex = 0;
+    check(BulkParser::parse(encode(ops, format), false, parsed, errorIndex, format) == BulkParser::Result::Ok &&
+              parsed.size() == 2,
+          label + "a valid bulk body is accepted");
+    check(BulkParser::parse(encodeWith(ops, format, "BobX", "Bob\xFF"), false, parsed, errorIndex, format) ==
+              BulkParser::Result::SyntaxError,
+          label + "a bulk body with a name that is not UTF-8 is rejected as malformed");
+    check(errorIndex == 1, label + "the error points at the operation with the bad name");
+}
+
+}  // namespace
+
+int main() {
+    checkFormat(Format::Cbor);
+    checkFormat(Format::MsgPack);
+
+    // JSON was already rejected by nlohmann's lexer; it must stay that way
+    User user;
+    check(UserParser::parse("{\"name\":\"Ann\xFF\",\"email\":\"ann@example.com\",\"age\":30}", user) ==
+              UserParser::Result::SyntaxError,
+          "JSON: a name that is not UTF-8 is rejected as malformed");
+
+    return failures == 0 ? 0 : 1;
+}
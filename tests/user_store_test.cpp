@@ -0,0 +1,236 @@
+// UserStore scans and EmailIndex under random churn, against std::set and
+// std::map references.
+//
+// UserStore keeps its id order and age index in SortedBlocks, and EmailIndex
+// keeps its keys in per-stripe arenas; both split, merge, grow and compact
+// as users come and go. Random inserts, age changes and erases (in runs, so
+// blocks empty out and merge) are checked against the references after
+// every round, including every cursor and age-range scan position used.
+//
+// Run by ctest; exits with status 1 on failure.
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "services/EmailIndex.hpp"
+#include "services/UserStore.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+User makeUser(int id, int age) {
+    return User(id, "User " + std::to_string(id), "user" + std::to_string(id) + "@example.com", age);
+}
+
+void checkScans(const UserStore& store, const std::set<int>& ids, const std::set<std::pair<int, int>>& byAge,
+                std::mt19937& rng, int round) {
+    std::string when = " (round " + std::to_string(round) + ")";
+    check(store.size() == ids.size(), "size matches" + when);
+    check(store.maxId() == (ids.empty() ? 0 : *ids.rbegin()), "maxId matches" + when);
+
+    std::vector<int> scanned;
+    store.forEachAfter(0, [&](const UserView& user) {
+        scanned.push_back(user.id);
+        return true;
+    });
+    check(scanned == std::vector<int>(ids.begin(), ids.end()), "a full id scan is in id order" + when);
+
+    // Pages of 10 from random cursors, present or not
+    std::uniform_int_distribution<int> anyId(0, ids.empty() ? 1 : *ids.rbegin() + 1);
+    for (int i = 0; i < 20; ++i) {
+        int after = anyId(rng);
+        std::vector<int> page;
+        store.forEachAfter(after, [&](const UserView& user) {
+            page.push_back(user.id);
+            return page.size() < 10;
+        });
+        std::vector<int> expected;
+        for (auto it = ids.upper_bound(after); it != ids.end() && expected.size() < 10; ++it) {
+            expected.push_back(*it);
+        }
+        check(page == expected, "a cursor page matches" + when);
+    }
+
+    std::uniform_int_distribution<int> anyAge(0, 100);
+    for (int i = 0; i < 20; ++i) {
+        std::pair<int, int> after(anyAge(rng), anyId(rng));
+        int maxAge = after.first + 5;
+        std::vector<std::pair<int, int>> page;
+        store.forEachByAge(after, maxAge, [&](const UserView& user) {
+            page.emplace_back(user.age, user.id);
+            return page.size() < 50;
+        });
+        std::vector<std::pair<int, int>> expected;
+        for (auto it = byAge.upper_bound(after); it != byAge.end() && it->first <= maxAge && expected.size() < 50;
+             ++it) {
+            expected.push_back(*it);
+        }
+        check(page == expected, "an age range page matches" + when);
+    }
+}
+
+void testUserStore() {
+    std::mt19937 rng(7);
+    UserStore store;
+    std::set<int> ids;
+    std::map<int, int> ages;
+    std::set<std::pair<int, int>> byAge;
+    int nextId = 1;
+
+    auto insert = [&](int id) {
+        int age = static_cast<int>(rng() % 101);
+        store.insert(makeUser(id, age));
+        ids.insert(id);
+        ages[id] = age;
+        byAge.emplace(age, id);
+    };
+    auto erase = [&](int id) {
+        check(store.erase(id), "erasing a stored id succeeds");
+        byAge.erase(std::make_pair(ages[id], id));
+        ages.erase(id);
+        ids.erase(id);
+    };
+
+    for (int round = 0; round < 40; ++round) {
+        // Mostly increasing ids, as the service hands them out, and some
+        // that land before the newest (creates racing across threads)
+        for (int i = 0; i < 2000; ++i) {
+            insert(nextId++);
+        }
+        for (int i = 0; i < 50; ++i) {
+            int id = nextId + 1 + static_cast<int>(rng() % 50);
+            if (!ids.count(id)) {
+                insert(id);
+            }
+        }
+        nextId += 60;
+
+        // Age changes move users around the age index
+        std::vector<int> all(ids.begin(), ids.end());
+        for (int i = 0; i < 500; ++i) {
+            int id = all[rng() % all.size()];
+            int age = static_cast<int>(rng() % 101);
+            store.update(id, makeUser(id, age), 1);
+            byAge.erase(std::make_pair(ages[id], id));
+            byAge.emplace(age, id);
+            ages[id] = age;
+        }
+
+        // Random erases, plus a contiguous run so whole blocks empty out
+        for (int i = 0; i < 800 && !ids.empty(); ++i) {
+            auto it = ids.lower_bound(static_cast<int>(rng() % static_cast<unsigned>(nextId)));
+            erase(it == ids.end() ? *ids.begin() : *it);
+        }
+        if (round % 5 == 4 && ids.size() > 3000) {
+            auto first = ids.begin();
+            std::advance(first, static_cast<long>(rng() % (ids.size() - 3000)));
+            std::vector<int> run(first, std::next(first, 3000));
+            for (int id : run) {
+                erase(id);
+            }
+        }
+        check(!store.erase(nextId + 1000), "erasing an absent id fails");
+
+        checkScans(store, ids, byAge, rng, round);
+    }
+
+    // Drain completely, then refill
+    std::vector<int> all(ids.begin(), ids.end());
+    for (int id : all) {
+        erase(id);
+    }
+    checkScans(store, ids, byAge, rng, -1);
+    for (int i = 0; i < 1000; ++i) {
+        insert(nextId++);
+    }
+    checkScans(store, ids, byAge, rng, -2);
+}
+
+void testEmailIndex() {
+    std::mt19937 rng(11);
+    EmailIndex index(4);
+    std::map<std::string, int> expected;
+
+    auto key = [](int n) { return "user" + std::to_string(n) + "@example.com"; };
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 5000; ++i) {
+            int n = static_cast<int>(rng() % 20000);
+            int id = n + 1 + static_cast<int>(rng() % 2) * 100000;  // Two ids compete for each key
+            std::string k = key(n);
+            switch (rng() % 4) {
+                case 0:
+                case 1: {
+                    bool free = !expected.count(k) || expected[k] == id;
+                    check(index.reserve(k, id) == free, "reserve succeeds exactly when the key is free");
+                    if (free) {
+                        expected[k] = id;
+                    }
+                    break;
+                }
+                case 2:
+                    index.release(k, id);
+                    if (expected.count(k) && expected[k] == id) {
+                        expected.erase(k);
+                    }
+                    break;
+                default: {
+                    // Claim, then assign, as a create does
+                    bool free = !expected.count(k);
+                    check(index.claim(k) == free, "claim succeeds exactly when nobody holds the key");
+                    if (free) {
+                        check(index.find(k) == 0, "a pending key is not found");
+                        check(!index.reserve(k, id), "a pending key cannot be reserved");
+                        index.assign(k, id);
+                        expected[k] = id;
+                    }
+                    break;
+                }
+            }
+        }
+
+        bool same = true;
+        for (int n = 0; n < 20000; ++n) {
+            auto it = expected.find(key(n));
+            same = same && index.find(key(n)) == (it == expected.end() ? 0 : it->second);
+        }
+        check(same, "every key maps to its id (round " + std::to_string(round) + ")");
+    }
+
+    // Release most keys, so the arenas are mostly garbage and get packed,
+    // then check that the rest survived the move
+    int kept = 0;
+    for (auto it = expected.begin(); it != expected.end();) {
+        if (kept++ % 8 != 0) {
+            index.release(it->first, it->second);
+            it = expected.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    bool same = true;
+    for (int n = 0; n < 20000; ++n) {
+        auto it = expected.find(key(n));
+        same = same && index.find(key(n)) == (it == expected.end() ? 0 : it->second);
+    }
+    check(same, "every key maps to its id after the arenas are packed");
+}
+
+}  // namespace
+
+int main() {
+    testUserStore();
+    testEmailIndex();
+    return failures == 0 ? 0 : 1;
+}